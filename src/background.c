@@ -18,6 +18,7 @@
 #include "image.h"
 #include "gradient.h"
 #include "hint.h"
+#include "screen.h"
 
 /** Enumeration of background types. */
 typedef unsigned char BackgroundType;
@@ -48,6 +49,8 @@ static BackgroundNode *lastBackground;
 
 static void LoadGradientBackground(BackgroundNode *bp);
 static void LoadImageBackground(BackgroundNode *bp);
+static void PrefetchImageBackground(BackgroundNode *bp);
+static int FindScreenWithSize(int index);
 
 /** Initialize any data needed for background support. */
 void InitializeBackgrounds(void)
@@ -63,6 +66,20 @@ void StartupBackgrounds(void)
 
    BackgroundNode *bp;
 
+   /* Start loading images in the background. */
+   for(bp = backgrounds; bp; bp = bp->next) {
+      switch(bp->type) {
+      case BACKGROUND_STRETCH:
+      case BACKGROUND_TILE:
+      case BACKGROUND_SCALE:
+         ExpandPath(&bp->value);
+         PrefetchImageBackground(bp);
+         break;
+      default:
+         break;
+      }
+   }
+
    for(bp = backgrounds; bp; bp = bp->next) {
 
       /* Load background data. */
@@ -279,42 +296,121 @@ void LoadGradientBackground(BackgroundNode *bp)
 
 }
 
-/** Load an image background. */
+/** Load an image background.
+ * Stretched and scaled images are loaded at the size of each screen so
+ * that the image is decoded at (or near) the size it will be shown.
+ */
 void LoadImageBackground(BackgroundNode *bp)
 {
 
+#ifdef USE_ICONS
+
    IconNode *ip;
-   int width, height;
+   ImageNode *image;
+   char *fileName;
+   const char preserveAspect = bp->type == BACKGROUND_SCALE;
+   int i;
 
-   /* Load the icon. */
+   bp->pixmap = None;
    ExpandPath(&bp->value);
-   ip = LoadNamedIcon(bp->value, 0, bp->type == BACKGROUND_SCALE);
-   if(JUNLIKELY(!ip || ip->width == 0)) {
-      bp->pixmap = None;
+   fileName = FindIconFile(bp->value);
+   if(JUNLIKELY(!fileName)) {
       Warning(_("background image not found: \"%s\""), bp->value);
       return;
    }
 
-   /* Determine the size of the background pixmap. */
+   /* Tiled images are used at their natural size. */
    if(bp->type == BACKGROUND_TILE) {
-      width = ip->width;
-      height = ip->height;
-   } else {
-      width = rootWidth;
-      height = rootHeight;
+      image = LoadImage(fileName, 0, 0, 1);
+      Release(fileName);
+      if(JUNLIKELY(!image)) {
+         Warning(_("background image not found: \"%s\""), bp->value);
+         return;
+      }
+      bp->pixmap = JXCreatePixmap(display, rootWindow,
+                                  image->width, image->height, rootDepth);
+      JXSetForeground(display, rootGC, 0);
+      JXFillRectangle(display, bp->pixmap, rootGC, 0, 0,
+                      image->width, image->height);
+      ip = CreateIconFromImage(image, 1);
+      PutIcon(ip, bp->pixmap, 0, 0, 0, ip->width, ip->height);
+      DestroyIcon(ip);
+      return;
    }
 
-   /* Create the pixmap. */
-   bp->pixmap = JXCreatePixmap(display, rootWindow, width, height, rootDepth);
-
-   /* Clear the pixmap in case it is too small. */
+   /* Create the pixmap, clearing it in case the image does not cover
+    * all of it. */
+   bp->pixmap = JXCreatePixmap(display, rootWindow, rootWidth, rootHeight,
+                               rootDepth);
    JXSetForeground(display, rootGC, 0);
-   JXFillRectangle(display, bp->pixmap, rootGC, 0, 0, width, height);
+   JXFillRectangle(display, bp->pixmap, rootGC, 0, 0, rootWidth, rootHeight);
+
+   /* Draw the image on each screen.
+    * Screens with the same size share the image already drawn. */
+   for(i = 0; i < GetScreenCount(); i++) {
+      const ScreenType *sp = GetScreen(i);
+      const int other = FindScreenWithSize(i);
+      if(other >= 0) {
+         const ScreenType *op = GetScreen(other);
+         JXCopyArea(display, bp->pixmap, bp->pixmap, rootGC,
+                    op->x, op->y, sp->width, sp->height, sp->x, sp->y);
+         continue;
+      }
+      image = LoadImage(fileName, sp->width, sp->height, preserveAspect);
+      if(JUNLIKELY(!image)) {
+         Warning(_("background image not found: \"%s\""), bp->value);
+         break;
+      }
+      ip = CreateIconFromImage(image, preserveAspect);
+      PutIcon(ip, bp->pixmap, 0, sp->x, sp->y, sp->width, sp->height);
+      DestroyIcon(ip);
+   }
+   Release(fileName);
+
+#else
 
-   /* Draw the icon on the background pixmap. */
-   PutIcon(ip, bp->pixmap, 0, 0, 0, width, height);
+   bp->pixmap = None;
+   Warning(_("background image not found: \"%s\""), bp->value);
+
+#endif
+
+}
 
-   /* We don't need the icon anymore. */
-   DestroyIcon(ip);
+/** Start loading the images needed for an image background. */
+void PrefetchImageBackground(BackgroundNode *bp)
+{
+#ifdef USE_PTHREAD
+   char *fileName = FindIconFile(bp->value);
+   if(fileName) {
+      if(bp->type == BACKGROUND_TILE) {
+         PrefetchImage(fileName, 0, 0, 1);
+      } else {
+         int i;
+         for(i = 0; i < GetScreenCount(); i++) {
+            if(FindScreenWithSize(i) < 0) {
+               const ScreenType *sp = GetScreen(i);
+               PrefetchImage(fileName, sp->width, sp->height,
+                             bp->type == BACKGROUND_SCALE);
+            }
+         }
+      }
+      Release(fileName);
+   }
+#endif
+}
 
+/** Find an earlier screen with the same size as the specified screen.
+ * Returns -1 if there is no such screen.
+ */
+int FindScreenWithSize(int index)
+{
+   const ScreenType *sp = GetScreen(index);
+   int i;
+   for(i = 0; i < index; i++) {
+      const ScreenType *op = GetScreen(i);
+      if(op->width == sp->width && op->height == sp->height) {
+         return i;
+      }
+   }
+   return -1;
 }
@@ -64,6 +64,9 @@ void StartupBorders(void)
 {
    unsigned int i;
 
+   for(i = 0; i < BI_COUNT; i++) {
+      PrefetchNamedIcon(buttonNames[i]);
+   }
    for(i = 0; i < BI_COUNT; i++) {
       if(buttonNames[i]) {
          buttonIcons[i] = LoadNamedIcon(buttonNames[i], 1, 1);
@@ -18,6 +18,7 @@
 #include "taskbar.h"
 #include "screen.h"
 #include "pager.h"
+#include "thumbnail.h"
 #include "color.h"
 #include "place.h"
 #include "event.h"
@@ -28,6 +29,15 @@
 
 static ClientNode *activeClient;
 
+/** The stacking order (top to bottom) last sent to the server.
+ * The count is -1 if the order is not known. */
+static Window *lastStack;
+static int lastStackCount;
+
+/** Urgent clients share one timer so that they flash in phase. */
+static unsigned int urgentCount;
+static char urgentFlash;
+
 unsigned int clientCount;
 
 static void LoadFocus(void);
@@ -36,6 +46,11 @@ static void MinimizeTransients(ClientNode *np, char lower);
 static void RestoreTransients(ClientNode *np, char raise);
 static void KillClientHandler(ClientNode *np);
 static void UnmapClient(ClientNode *np);
+static void ApplyStackOrder(Window *stack, int count);
+static void ForgetStackedWindow(Window w);
+static int CompareStackEntries(const void *a, const void *b);
+static void SignalUrgent(const TimeType *now, int x, int y, Window w,
+                         void *data);
 
 /** Load windows that are already mapped. */
 void StartupClients(void)
@@ -49,6 +64,8 @@ void StartupClients(void)
    clientCount = 0;
    activeClient = NULL;
    currentDesktop = 0;
+   lastStack = NULL;
+   lastStackCount = -1;
 
    /* Clear out the client lists. */
    for(x = 0; x < LAYER_COUNT; x++) {
@@ -90,6 +107,12 @@ void ShutdownClients(void)
       }
    }
 
+   if(lastStack) {
+      Release(lastStack);
+      lastStack = NULL;
+   }
+   lastStackCount = -1;
+
 }
 
 /** Set the focus to the window currently under the mouse pointer. */
@@ -179,6 +202,11 @@ ClientNode *AddClientWindow(Window w, char alreadyMapped, char notOwner)
       nodeTail[np->state.layer] = np;
    }
    nodes[np->state.layer] = np;
+   np->desktopList = -1;
+   np->pagerDesktop = -1;
+   np->thumbnail = NULL;
+   UpdateDesktopList(np);
+   AddToFocusHistory(np);
 
    SetDefaultCursor(np->window);
 
@@ -246,9 +274,7 @@ ClientNode *AddClientWindow(Window w, char alreadyMapped, char notOwner)
       MaximizeClient(np, flags);
    }
 
-   if(np->state.status & STAT_URGENT) {
-      RegisterCallback(URGENCY_DELAY, SignalUrgent, np);
-   }
+   RegisterUrgentClient(np);
 
    /* Update task bars. */
    AddClientToTaskBar(np);
@@ -565,6 +591,7 @@ void SetClientSticky(ClientNode *np, char isSticky)
          for(tp = nodes[x]; tp; tp = tp->next) {
             if(tp == np || tp->owner == np->window) {
                tp->state.status |= STAT_STICKY;
+               UpdateDesktopList(tp);
                SetCardinalAtom(tp->window, ATOM_NET_WM_DESKTOP, ~0UL);
                WriteState(tp);
             }
@@ -579,6 +606,7 @@ void SetClientSticky(ClientNode *np, char isSticky)
          for(tp = nodes[x]; tp; tp = tp->next) {
             if(tp == np || tp->owner == np->window) {
                tp->state.status &= ~STAT_STICKY;
+               UpdateDesktopList(tp);
                WriteState(tp);
             }
          }
@@ -613,6 +641,7 @@ void SetClientDesktop(ClientNode *np, unsigned int desktop)
             if(tp == np || tp->owner == np->window) {
 
                tp->state.desktop = desktop;
+               UpdateDesktopList(tp);
 
                if(desktop == currentDesktop) {
                   ShowClient(tp);
@@ -850,6 +879,8 @@ void FocusClient(ClientNode *np)
       RequireTaskUpdate();
    }
 
+   UpdateFocusHistory(np);
+
    if(np->state.status & STAT_MAPPED) {
       UpdateClientColormap(np);
       SetWindowAtom(rootWindow, ATOM_NET_ACTIVE_WINDOW, np->window);
@@ -1152,14 +1183,174 @@ void RestackClients(void)
 
    }
 
-   JXRestackWindows(display, stack, index);
+   ApplyStackOrder(stack, index);
 
    ReleaseStack(stack);
-   UpdateNetClientList();
+   RequireClientListUpdate();
    RequirePagerUpdate();
 
 }
 
+/** Stacking order entry used to find the old position of a window. */
+typedef struct StackEntry {
+   Window window;
+   int index;
+} StackEntry;
+
+/** Compare stack entries by window (for qsort and bsearch). */
+int CompareStackEntries(const void *a, const void *b)
+{
+   const Window wa = ((const StackEntry*)a)->window;
+   const Window wb = ((const StackEntry*)b)->window;
+   if(wa < wb) {
+      return -1;
+   } else if(wa > wb) {
+      return 1;
+   } else {
+      return 0;
+   }
+}
+
+/** Send a new stacking order (top to bottom) to the server.
+ * Rather than restacking every window, this finds the longest run of
+ * windows that are already in the right relative order (the longest
+ * increasing subsequence of their old positions) and only moves the
+ * other windows. This keeps the number of windows the server has to
+ * restack (and the exposures that result) small.
+ */
+void ApplyStackOrder(Window *stack, int count)
+{
+   StackEntry *entries;
+   int *position;       /* Old position of each window (-1 if new). */
+   int *tails;          /* Index of the smallest tail of each length. */
+   int *previous;       /* Previous index in the subsequence. */
+   char *keep;          /* Set for windows that do not need to move. */
+   int length;
+   int first;
+   int i;
+
+   if(lastStackCount < 0 || count == 0) {
+      JXRestackWindows(display, stack, count);
+      goto SaveOrder;
+   }
+
+   /* Look up the old position of each window. */
+   entries = AllocateStack(sizeof(StackEntry) * (lastStackCount + 1));
+   for(i = 0; i < lastStackCount; i++) {
+      entries[i].window = lastStack[i];
+      entries[i].index = i;
+   }
+   qsort(entries, lastStackCount, sizeof(StackEntry), CompareStackEntries);
+   position = AllocateStack(sizeof(int) * count);
+   for(i = 0; i < count; i++) {
+      StackEntry key;
+      const StackEntry *ep;
+      key.window = stack[i];
+      ep = bsearch(&key, entries, lastStackCount, sizeof(StackEntry),
+                   CompareStackEntries);
+      position[i] = ep ? ep->index : -1;
+   }
+   ReleaseStack(entries);
+
+   /* Find the longest increasing subsequence of old positions. */
+   tails = AllocateStack(sizeof(int) * count);
+   previous = AllocateStack(sizeof(int) * count);
+   length = 0;
+   for(i = 0; i < count; i++) {
+      int low = 0;
+      int high = length;
+      if(position[i] < 0) {
+         continue;
+      }
+      while(low < high) {
+         const int mid = (low + high) / 2;
+         if(position[tails[mid]] < position[i]) {
+            low = mid + 1;
+         } else {
+            high = mid;
+         }
+      }
+      previous[i] = low > 0 ? tails[low - 1] : -1;
+      tails[low] = i;
+      if(low == length) {
+         length += 1;
+      }
+   }
+   keep = AllocateStack(count);
+   for(i = 0; i < count; i++) {
+      keep[i] = 0;
+   }
+   for(i = length > 0 ? tails[length - 1] : -1; i >= 0; i = previous[i]) {
+      keep[i] = 1;
+   }
+   ReleaseStack(previous);
+   ReleaseStack(tails);
+   ReleaseStack(position);
+
+   /* Move the windows that are out of place.
+    * Each window goes directly below the window before it. The top
+    * window, if out of place, goes above the top window we kept. */
+   first = -1;
+   for(i = 0; i < count; i++) {
+      if(keep[i]) {
+         first = i;
+         break;
+      }
+   }
+   for(i = 0; i < count; i++) {
+      XWindowChanges changes;
+      if(keep[i]) {
+         continue;
+      }
+      if(i > 0) {
+         changes.sibling = stack[i - 1];
+         changes.stack_mode = Below;
+      } else if(first >= 0) {
+         changes.sibling = stack[first];
+         changes.stack_mode = Above;
+      } else {
+         /* Nothing is where it was; leave the top window alone. */
+         continue;
+      }
+      JXConfigureWindow(display, stack[i], CWSibling | CWStackMode, &changes);
+   }
+   ReleaseStack(keep);
+
+SaveOrder:
+
+   /* Remember the order for next time. */
+   if(lastStack) {
+      Release(lastStack);
+   }
+   lastStack = Allocate(sizeof(Window) * (count + 1));
+   memcpy(lastStack, stack, sizeof(Window) * count);
+   lastStackCount = count;
+
+}
+
+/** Remove a window that is going away from the saved stacking order. */
+void ForgetStackedWindow(Window w)
+{
+   int i;
+   for(i = 0; i < lastStackCount; i++) {
+      if(lastStack[i] == w) {
+         memmove(&lastStack[i], &lastStack[i + 1],
+                 sizeof(Window) * (lastStackCount - i - 1));
+         lastStackCount -= 1;
+         return;
+      }
+   }
+}
+
+/** Forget the stacking order last sent to the server.
+ * This must be called if frame or tray windows are restacked directly
+ * so that the next RestackClients call restacks everything.
+ */
+void InvalidateStackOrder(void)
+{
+   lastStackCount = -1;
+}
+
 /** Send a client message to a window. */
 void SendClientMessage(Window w, AtomType type, AtomType message)
 {
@@ -1203,14 +1394,15 @@ void RemoveClient(ClientNode *np)
       nodes[np->state.layer] = np->next;
    }
    clientCount -= 1;
+   RemoveFromDesktopList(np);
+   RemoveFromFocusHistory(np);
+   RemoveThumbnail(np);
    XDeleteContext(display, np->window, clientContext);
    if(np->parent != None) {
       XDeleteContext(display, np->parent, frameContext);
    }
 
-   if(np->state.status & STAT_URGENT) {
-      UnregisterCallback(SignalUrgent, np);
-   }
+   UnregisterUrgentClient(np);
 
    /* Make sure this client isn't active */
    if(activeClient == np && !shouldExit) {
@@ -1250,7 +1442,11 @@ void RemoveClient(ClientNode *np)
    /* Destroy the parent */
    if(np->parent) {
       JXDestroyWindow(display, np->parent);
+      ForgetWindowProperties(np->parent);
+      ForgetStackedWindow(np->parent);
    }
+   ForgetWindowProperties(np->window);
+   ForgetStackedWindow(np->window);
 
    if(np->name) {
       Release(np->name);
@@ -1274,7 +1470,7 @@ void RemoveClient(ClientNode *np)
       np->colormaps = cp;
    }
 
-   DestroyIcon(np->icon);
+   DestroyClientIcon(np);
 
    Release(np);
 
@@ -1339,6 +1535,8 @@ void ReparentClient(ClientNode *np)
       JXReparentWindow(display, np->window, rootWindow, np->x, np->y);
       XDeleteContext(display, np->parent, frameContext);
       JXDestroyWindow(display, np->parent);
+      ForgetWindowProperties(np->parent);
+      ForgetStackedWindow(np->parent);
       np->parent = None;
 
    } else {
@@ -1399,8 +1597,11 @@ void ReparentClient(ClientNode *np)
       }
    }
 
+   /* Discard the unmap events caused by reparenting along with any
+    * still pending from UnmapClient. */
    JXSync(display, False);
-   JXCheckTypedWindowEvent(display, np->window, UnmapNotify, &event);
+   while(JXCheckTypedWindowEvent(display, np->window, UnmapNotify, &event));
+   np->ignoreUnmap = 0;
 
 }
 
@@ -1471,39 +1672,73 @@ void UpdateClientColormap(ClientNode *np)
 
 }
 
-/** Update callback for clients with the urgency hint set. */
+/** Start flashing a client if it has the urgency hint set. */
+void RegisterUrgentClient(ClientNode *np)
+{
+   if(np->state.status & STAT_URGENT) {
+      if(urgentCount == 0) {
+         urgentFlash = 0;
+         RegisterCallback(URGENCY_DELAY, SignalUrgent, NULL);
+      }
+      urgentCount += 1;
+   }
+}
+
+/** Stop flashing a client if it has the urgency hint set. */
+void UnregisterUrgentClient(ClientNode *np)
+{
+   if(np->state.status & STAT_URGENT) {
+      Assert(urgentCount > 0);
+      urgentCount -= 1;
+      if(urgentCount == 0) {
+         UnregisterCallback(SignalUrgent, NULL);
+      }
+   }
+}
+
+/** Update callback for clients with the urgency hint set.
+ * All urgent clients are toggled together so their borders, task
+ * entries, and pager entries are redrawn once per period.
+ */
 void SignalUrgent(const TimeType *now, int x, int y, Window w, void *data)
 {
 
-   ClientNode *np = (ClientNode*)data;
+   ClientNode *np;
+   int layer;
 
-   /* Redraw borders. */
-   if(np->state.status & STAT_FLASH) {
-      np->state.status &= ~STAT_FLASH;
-   } else if(!(np->state.status & STAT_NOTURGENT)) {
-      np->state.status |= STAT_FLASH;
+   urgentFlash = !urgentFlash;
+   for(layer = FIRST_LAYER; layer <= LAST_LAYER; layer++) {
+      for(np = nodes[layer]; np; np = np->next) {
+         if(!(np->state.status & STAT_URGENT)) {
+            continue;
+         }
+         if(urgentFlash && !(np->state.status & STAT_NOTURGENT)) {
+            np->state.status |= STAT_FLASH;
+         } else {
+            np->state.status &= ~STAT_FLASH;
+         }
+         DrawBorder(np);
+      }
    }
-   DrawBorder(np);
    RequireTaskUpdate();
    RequirePagerUpdate();
 
 }
 
-/** Unmap a client window and consume the UnmapNotify event. */
+/** Unmap a client window.
+ * Rather than waiting for the UnmapNotify event here, we count it so
+ * that HandleUnmapNotify can discard it when it arrives. This allows
+ * many clients to be unmapped without a round trip for each.
+ */
 void UnmapClient(ClientNode *np)
 {
    if(np->state.status & STAT_MAPPED) {
-      XEvent e;
 
       /* Unmap the window and record that we did so. */
       np->state.status &= ~STAT_MAPPED;
+      np->ignoreUnmap += 1;
       JXUnmapWindow(display, np->window);
 
-      /* Discard the unmap event so we don't process it later. */
-      JXSync(display, False);
-      if(JXCheckTypedWindowEvent(display, np->window, UnmapNotify, &e)) {
-         UpdateTime(&e);
-      }
    }
 }
 
@@ -14,6 +14,7 @@
 #include "border.h"
 #include "hint.h"
 
+struct ThumbnailNode;
 struct TimeType;
 
 /** Window border flags.
@@ -152,6 +153,13 @@ typedef struct ClientNode {
    MouseContextType mouseContext;
 
    struct IconNode *icon;     /**< Icon assigned to this window. */
+   unsigned iconSerial;       /**< Changes each time the icon is loaded. */
+
+   /** Task bar entry for this window (see taskbar.c). */
+   struct ClientEntry *taskEntry;
+
+   /** Number of UnmapNotify events caused by us that are still pending. */
+   unsigned int ignoreUnmap;
 
    /** Callback to stop move/resize. */
    void (*controller)(int wasDestroyed);
@@ -159,6 +167,24 @@ typedef struct ClientNode {
    struct ClientNode *prev;   /**< The previous client in this layer. */
    struct ClientNode *next;   /**< The next client in this layer. */
 
+   struct ClientNode *desktopPrev;  /**< Previous client on the desktop. */
+   struct ClientNode *desktopNext;  /**< Next client on the desktop. */
+   int desktopList;                 /**< Desktop list containing this
+                                     *   client (-1 if none). */
+
+   struct ClientNode *focusPrev;    /**< Client focused more recently. */
+   struct ClientNode *focusNext;    /**< Client focused less recently. */
+
+   /* Client state as last drawn on the pager (see pager.c). */
+   int pagerDesktop;          /**< Desktop drawn on (-1 if not drawn). */
+   int pagerIndex;            /**< Stacking position on that desktop. */
+   int pagerX, pagerY;        /**< Location. */
+   int pagerWidth;            /**< Width. */
+   int pagerHeight;           /**< Height. */
+   unsigned char pagerColor;  /**< Fill color. */
+
+   struct ThumbnailNode *thumbnail; /**< Pager thumbnail (see thumbnail.c). */
+
 } ClientNode;
 
 /** The number of clients (maintained in client.c). */
@@ -290,6 +316,13 @@ void RestackClient(ClientNode *np, Window above, int detail);
  */
 void RestackClients(void);
 
+/** Forget the stacking order last set by RestackClients.
+ * RestackClients only moves windows that are out of order with respect
+ * to the last order it set. This must be called after restacking frame
+ * or tray windows directly.
+ */
+void InvalidateStackOrder(void);
+
 /** Set the layer of a client.
  * @param np The client whose layer to set.
  * @param layer the layer to assign to the client.
@@ -346,9 +379,16 @@ void SendConfigureEvent(ClientNode *np);
  */
 void SendClientMessage(Window w, AtomType type, AtomType message);
 
-/** Update callback for clients with the urgency hint set. */
-void SignalUrgent(const struct TimeType *now, int x, int y, Window w,
-                  void *data);
+/** Start flashing a client if it has the urgency hint set.
+ * @param np The client.
+ */
+void RegisterUrgentClient(ClientNode *np);
+
+/** Stop flashing a client if it has the urgency hint set.
+ * This must be called before the urgency hint is cleared.
+ * @param np The client.
+ */
+void UnregisterUrgentClient(ClientNode *np);
 
 #endif /* CLIENT_H */
 
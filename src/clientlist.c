@@ -18,12 +18,163 @@
 ClientNode *nodes[LAYER_COUNT];
 ClientNode *nodeTail[LAYER_COUNT];
 
+/** Clients on each desktop.
+ * The list at index settings.desktopCount contains sticky clients. */
+static ClientNode **desktopNodes = NULL;
+
+/** Clients in most recently focused order. */
+static ClientNode *focusHead = NULL;
+static ClientNode *focusTail = NULL;
+
 static Window *windowStack = NULL;  /**< Image of the window stack. */
 static int windowStackSize = 0;     /**< Size of the image. */
 static int windowStackCurrent = 0;  /**< Current location in the image. */
 static char walkingWindows = 0;     /**< Are we walking windows? */
 static char wasMinimized = 0;       /**< Was the current window minimized? */
 
+/** Startup client lists. */
+void StartupClientList(void)
+{
+   unsigned int x;
+   desktopNodes = Allocate(sizeof(ClientNode*) * (settings.desktopCount + 1));
+   for(x = 0; x <= settings.desktopCount; x++) {
+      desktopNodes[x] = NULL;
+   }
+}
+
+/** Shutdown client lists. */
+void ShutdownClientList(void)
+{
+   if(desktopNodes) {
+      Release(desktopNodes);
+      desktopNodes = NULL;
+   }
+   focusHead = NULL;
+   focusTail = NULL;
+}
+
+/** Update the desktop list containing a client. */
+void UpdateDesktopList(ClientNode *np)
+{
+   int list;
+   if(np->state.status & STAT_STICKY) {
+      list = settings.desktopCount;
+   } else {
+      list = np->state.desktop;
+   }
+   if(list != np->desktopList) {
+      RemoveFromDesktopList(np);
+      np->desktopList = list;
+      np->desktopPrev = NULL;
+      np->desktopNext = desktopNodes[list];
+      if(np->desktopNext) {
+         np->desktopNext->desktopPrev = np;
+      }
+      desktopNodes[list] = np;
+   }
+}
+
+/** Remove a client from its desktop list. */
+void RemoveFromDesktopList(ClientNode *np)
+{
+   if(np->desktopList >= 0) {
+      if(np->desktopPrev) {
+         np->desktopPrev->desktopNext = np->desktopNext;
+      } else {
+         desktopNodes[np->desktopList] = np->desktopNext;
+      }
+      if(np->desktopNext) {
+         np->desktopNext->desktopPrev = np->desktopPrev;
+      }
+      np->desktopList = -1;
+   }
+}
+
+/** Get the clients on a desktop. */
+ClientNode *GetDesktopClients(unsigned int desktop)
+{
+   Assert(desktop < settings.desktopCount);
+   return desktopNodes[desktop];
+}
+
+/** Get the sticky clients. */
+ClientNode *GetStickyClients(void)
+{
+   return desktopNodes[settings.desktopCount];
+}
+
+/** Get the first client visible on a desktop. */
+ClientNode *GetFirstVisibleClient(unsigned int desktop)
+{
+   Assert(desktop < settings.desktopCount);
+   if(desktopNodes[desktop]) {
+      return desktopNodes[desktop];
+   }
+   return desktopNodes[settings.desktopCount];
+}
+
+/** Get the next client visible on the same desktop. */
+ClientNode *GetNextVisibleClient(const ClientNode *np)
+{
+   if(np->desktopNext) {
+      return np->desktopNext;
+   } else if(np->desktopList != settings.desktopCount) {
+      return desktopNodes[settings.desktopCount];
+   } else {
+      return NULL;
+   }
+}
+
+/** Add a client to the end of the focus history. */
+void AddToFocusHistory(ClientNode *np)
+{
+   np->focusNext = NULL;
+   np->focusPrev = focusTail;
+   if(focusTail) {
+      focusTail->focusNext = np;
+   } else {
+      focusHead = np;
+   }
+   focusTail = np;
+}
+
+/** Move a client to the front of the focus history. */
+void UpdateFocusHistory(ClientNode *np)
+{
+   if(windowStack != NULL || focusHead == np) {
+      return;
+   }
+   RemoveFromFocusHistory(np);
+   np->focusPrev = NULL;
+   np->focusNext = focusHead;
+   if(focusHead) {
+      focusHead->focusPrev = np;
+   } else {
+      focusTail = np;
+   }
+   focusHead = np;
+}
+
+/** Remove a client from the focus history. */
+void RemoveFromFocusHistory(ClientNode *np)
+{
+   if(np->focusPrev) {
+      np->focusPrev->focusNext = np->focusNext;
+   } else if(focusHead == np) {
+      focusHead = np->focusNext;
+   } else {
+      /* Not in the list. */
+      return;
+   }
+   if(np->focusNext) {
+      np->focusNext->focusPrev = np->focusPrev;
+   } else {
+      focusTail = np->focusPrev;
+   }
+   np->focusPrev = NULL;
+   np->focusNext = NULL;
+}
+
 /** Determine if a client is allowed focus. */
 char ShouldFocus(const ClientNode *np, char current)
 {
@@ -66,13 +217,12 @@ void StartWindowWalk(void)
 void StartWindowStackWalk(void)
 {
 
-   /* Get an image of the window stack.
+   /* Get an image of the focus history.
     * Here we get the Window IDs rather than client pointers so
     * clients can be added/removed without disrupting the stack walk.
     */
 
    ClientNode *np;
-   int layer;
    int count;
 
    /* If we are already walking the stack, just return. */
@@ -82,11 +232,9 @@ void StartWindowStackWalk(void)
 
    /* First determine how much space to allocate for windows. */
    count = 0;
-   for(layer = LAST_LAYER; layer >= FIRST_LAYER; layer--) {
-      for(np = nodes[layer]; np; np = np->next) {
-         if(ShouldFocus(np, 1)) {
-            ++count;
-         }
+   for(np = focusHead; np; np = np->focusNext) {
+      if(ShouldFocus(np, 1)) {
+         ++count;
       }
    }
 
@@ -100,11 +248,9 @@ void StartWindowStackWalk(void)
 
    /* Copy windows into the array. */
    windowStackSize = 0;
-   for(layer = LAST_LAYER; layer >= FIRST_LAYER; layer--) {
-      for(np = nodes[layer]; np; np = np->next) {
-         if(ShouldFocus(np, 1)) {
-            windowStack[windowStackSize++] = np->window;
-         }
+   for(np = focusHead; np; np = np->focusNext) {
+      if(ShouldFocus(np, 1)) {
+         windowStack[windowStackSize++] = np->window;
       }
    }
 
@@ -163,8 +309,8 @@ void WalkWindowStack(char forward)
          }
 
          /* Show the window.
-          * Only when the walk completes do we update the stacking order. */
-         RestackClients();
+          * Only the frame is raised here; the stacking order is updated
+          * when the walk completes. */
          if(np->state.status & STAT_MINIMIZED) {
             RestoreClient(np, 1);
             wasMinimized = 1;
@@ -172,6 +318,7 @@ void WalkWindowStack(char forward)
             wasMinimized = 0;
          }
          JXRaiseWindow(display, np->parent ? np->parent : np->window);
+         InvalidateStackOrder();
          FocusClient(np);
          break;
 
@@ -192,19 +339,22 @@ void StopWindowWalk(void)
 
       /* Look up the current window. */
       np = FindClientByWindow(windowStack[windowStackCurrent]);
+
+      Release(windowStack);
+      windowStack = NULL;
+
+      windowStackSize = 0;
+      windowStackCurrent = 0;
+
       if(np) {
          if(np->state.status & STAT_MINIMIZED) {
             RestoreClient(np, 1);
          } else {
             RaiseClient(np);
          }
+         UpdateFocusHistory(np);
       }
-
-      Release(windowStack);
-      windowStack = NULL;
-
-      windowStackSize = 0;
-      windowStackCurrent = 0;
+      RequireRestack();
 
    }
 
@@ -20,6 +20,71 @@ extern struct ClientNode *nodes[LAYER_COUNT];
 /** Client windows in linked lists for each layer (pointer to the tail). */
 extern struct ClientNode *nodeTail[LAYER_COUNT];
 
+/*@{*/
+#define InitializeClientList()   (void)(0)
+void StartupClientList(void);
+void ShutdownClientList(void);
+#define DestroyClientList()      (void)(0)
+/*@}*/
+
+/** Update the desktop list containing a client.
+ * Clients are kept in a list for each desktop (and a list for sticky
+ * clients) so that desktop switches only need to look at the clients
+ * on the desktops involved. This must be called whenever the desktop
+ * or sticky status of a managed client changes.
+ * @param np The client.
+ */
+void UpdateDesktopList(struct ClientNode *np);
+
+/** Remove a client from its desktop list.
+ * @param np The client.
+ */
+void RemoveFromDesktopList(struct ClientNode *np);
+
+/** Get the clients on a desktop, not including sticky clients.
+ * The list is linked through desktopNext.
+ * @param desktop The desktop.
+ * @return The first client on the desktop (NULL if none).
+ */
+struct ClientNode *GetDesktopClients(unsigned int desktop);
+
+/** Get the sticky clients.
+ * The list is linked through desktopNext.
+ * @return The first sticky client (NULL if none).
+ */
+struct ClientNode *GetStickyClients(void);
+
+/** Get the first client visible on a desktop.
+ * This is used with GetNextVisibleClient to visit the clients on a
+ * desktop followed by the sticky clients.
+ * @param desktop The desktop.
+ * @return The first client (NULL if none).
+ */
+struct ClientNode *GetFirstVisibleClient(unsigned int desktop);
+
+/** Get the next client visible on the same desktop.
+ * @param np The current client.
+ * @return The next client (NULL if none).
+ */
+struct ClientNode *GetNextVisibleClient(const struct ClientNode *np);
+
+/** Add a client to the end of the focus history.
+ * @param np The client.
+ */
+void AddToFocusHistory(struct ClientNode *np);
+
+/** Move a client to the front of the focus history.
+ * This is called whenever a client receives focus. Focus changes made
+ * while walking the window stack are not recorded until the walk ends.
+ * @param np The client.
+ */
+void UpdateFocusHistory(struct ClientNode *np);
+
+/** Remove a client from the focus history.
+ * @param np The client.
+ */
+void RemoveFromFocusHistory(struct ClientNode *np);
+
 /** Determine if a client is on the current desktop.
  * @param np The client.
  * @return 1 if on the current desktop, 0 otherwise.
@@ -38,7 +103,9 @@ char ShouldFocus(const struct ClientNode *np, char current);
 /** Start walking the window client list. */
 void StartWindowWalk(void);
 
-/** Start walking the window stack. */
+/** Start walking the window stack.
+ * Windows are visited in most recently focused order.
+ */
 void StartWindowStackWalk();
 
 /** Move to the next/previous window in the window stack. */
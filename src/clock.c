@@ -32,11 +32,6 @@ typedef struct ClockType {
    struct ActionNode *actions;   /**< Actions */
    TimeType lastTime;            /**< Currently displayed time. */
 
-   /* The following are used to control popups. */
-   int mousex;                /**< Last mouse x-coordinate. */
-   int mousey;                /**< Last mouse y-coordinate. */
-   TimeType mouseTime;        /**< Time of the last mouse motion. */
-
    int userWidth;             /**< User-specified clock width (or 0). */
 
    struct ClockType *next;    /**< Next clock in the list. */
@@ -62,6 +57,7 @@ static void DrawClock(ClockType *clk, const TimeType *now);
 
 static void SignalClock(const struct TimeType *now, int x, int y, Window w,
                         void *data);
+static const char *GetClockPopup(void *object, int x, int y);
 
 
 /** Initialize clocks. */
@@ -116,10 +112,6 @@ TrayComponentType *CreateClock(const char *format, const char *zone,
    clk->next = clocks;
    clocks = clk;
 
-   clk->mousex = -settings.doubleClickDelta;
-   clk->mousey = -settings.doubleClickDelta;
-   clk->mouseTime.seconds = 0;
-   clk->mouseTime.ms = 0;
    clk->userWidth = 0;
 
    if(!format) {
@@ -149,7 +141,7 @@ TrayComponentType *CreateClock(const char *format, const char *zone,
    cp->ProcessButtonRelease = ProcessClockButtonRelease;
    cp->ProcessMotionEvent = ProcessClockMotionEvent;
 
-   RegisterCallback(Min(900, settings.popupDelay / 2), SignalClock, clk);
+   RegisterCallback(900, SignalClock, clk);
 
    return cp;
 }
@@ -224,9 +216,15 @@ void ProcessClockMotionEvent(TrayComponentType *cp,
                              int x, int y, int mask)
 {
    ClockType *clk = (ClockType*)cp->object;
-   clk->mousex = cp->screenx + x;
-   clk->mousey = cp->screeny + y;
-   GetCurrentTime(&clk->mouseTime);
+   HoverPopup(GetClockPopup, clk, POPUP_CLOCK, cp->tray->window,
+              cp->screenx + x, cp->screeny + y);
+}
+
+/** Get the popup text for a clock. */
+const char *GetClockPopup(void *object, int x, int y)
+{
+   const ClockType *clk = (ClockType*)object;
+   return GetTimeString("%c", clk->zone);
 }
 
 /** Update a clock tray component. */
@@ -234,17 +232,7 @@ void SignalClock(const TimeType *now, int x, int y, Window w, void *data)
 {
 
    ClockType *cp = (ClockType*)data;
-   const char *longTime;
-
    DrawClock(cp, now);
-   if(cp->cp->tray->window == w &&
-      abs(cp->mousex - x) < settings.doubleClickDelta &&
-      abs(cp->mousey - y) < settings.doubleClickDelta) {
-      if(GetTimeDifference(now, &cp->mouseTime) >= settings.popupDelay) {
-         longTime = GetTimeString("%c", cp->zone);
-         ShowPopup(x, y, longTime, POPUP_CLOCK);
-      }
-   }
 
 }
 
@@ -13,8 +13,15 @@
 #include "main.h"
 #include "error.h"
 #include "timing.h"
+#include "event.h"
 
 #include <fcntl.h>
+#include <errno.h>
+
+#if defined(HAVE_SPAWN_H) && defined(HAVE_POSIX_SPAWNP)
+#  define USE_POSIX_SPAWN
+extern char **environ;
+#endif
 
 /** Structure to represent a list of commands. */
 typedef struct CommandNode {
@@ -22,6 +29,22 @@ typedef struct CommandNode {
    struct CommandNode *next;  /**< The next command in the list. */
 } CommandNode;
 
+/** Structure to represent output being read from a process. */
+typedef struct ProcessNode {
+   char *command;             /**< The command (for warnings). */
+   pid_t pid;                 /**< The process. */
+   int fd;                    /**< Read end of the pipe. */
+   char *buffer;              /**< Output read so far. */
+   unsigned size;             /**< Bytes in the buffer. */
+   unsigned maxSize;          /**< Size of the buffer. */
+   unsigned timeout;          /**< Timeout in milliseconds. */
+   ProcessCallback callback;  /**< Callback for the output. */
+   void *data;                /**< Data for the callback. */
+   struct ProcessNode *next;  /**< The next process in the list. */
+} ProcessNode;
+
+static ProcessNode *processes = NULL;
+
 static CommandNode *startupCommands = NULL;
 static CommandNode *shutdownCommands = NULL;
 static CommandNode *restartCommands = NULL;
@@ -29,6 +52,13 @@ static CommandNode *restartCommands = NULL;
 static void RunCommands(CommandNode *commands);
 static void ReleaseCommands(CommandNode **commands);
 static void AddCommand(CommandNode **commands, const char *command);
+static void HandleProcessOutput(int fd, void *data);
+static void SignalProcessTimeout(const TimeType *now, int x, int y,
+                                 Window w, void *data);
+static void ReleaseProcess(ProcessNode *pp);
+static char CreatePipe(int fds[2]);
+static pid_t SpawnCommand(const char *command, int output);
+static char **CreateArguments(const char *command);
 
 /** Process startup/restart commands. */
 void StartupCommands(void)
@@ -120,28 +150,10 @@ void AddRestartCommand(const char *command) {
 /** Execute an external program. */
 void RunCommand(const char *command)
 {
-
-   const char *displayString;
-
    if(JUNLIKELY(!command)) {
       return;
    }
-
-   displayString = DisplayString(display);
-   if(!fork()) {
-      close(ConnectionNumber(display));
-      if(displayString && displayString[0]) {
-         const size_t var_len = strlen(displayString) + 9;
-         char *str = malloc(var_len);
-         snprintf(str, var_len, "DISPLAY=%s", displayString);
-         putenv(str);
-      }
-      setsid();
-      execl(SHELL_NAME, SHELL_NAME, "-c", command, NULL);
-      Warning(_("exec failed: (%s) %s"), SHELL_NAME, command);
-      exit(EXIT_SUCCESS);
-   }
-
+   SpawnCommand(command, -1);
 }
 
 /** Reads the output of an exernal program. */
@@ -151,8 +163,7 @@ char *ReadFromProcess(const char *command, unsigned timeout_ms)
    pid_t pid;
    int fds[2];
 
-   if(pipe(fds)) {
-      Warning(_("could not create pipe"));
+   if(JUNLIKELY(!CreatePipe(fds))) {
       return NULL;
    }
    if(fcntl(fds[0], F_SETFL, O_NONBLOCK) == -1) {
@@ -161,17 +172,11 @@ char *ReadFromProcess(const char *command, unsigned timeout_ms)
       Warning(_("could not set O_NONBLOCK"));
    }
 
-   pid = fork();
-   if(pid == 0) {
-      /* The child process. */
-      close(ConnectionNumber(display));
-      close(fds[0]);
-      dup2(fds[1], 1);  /* stdout */
-      setsid();
-      execl("/bin/sh", "/bin/sh", "-c", command, NULL);
-      Warning(_("exec failed: (%s) %s"), SHELL_NAME, command);
-      exit(EXIT_SUCCESS);
-   } else if(pid > 0) {
+   /* Close our copy of the write end so we see EOF when the child
+    * exits. */
+   pid = SpawnCommand(command, fds[1]);
+   close(fds[1]);
+   if(pid > 0) {
       char *buffer;
       unsigned buffer_size, max_size;
       TimeType start_time, current_time;
@@ -217,23 +222,290 @@ char *ReadFromProcess(const char *command, unsigned timeout_ms)
          rc = read(fds[0], &buffer[buffer_size], BLOCK_SIZE);
          if(rc > 0) {
             buffer_size += rc;
-         } else {
-            /* Process exited, check for any leftovers and return. */
-            do {
-               if(buffer_size + BLOCK_SIZE > max_size) {
-                  max_size *= 2;
-                  buffer = Reallocate(buffer, max_size);
-               }
-               rc = read(fds[0], &buffer[buffer_size], BLOCK_SIZE);
-               buffer_size += (rc > 0) ? rc : 0;
-            } while(rc > 0);
+         } else if(rc == 0 || (errno != EAGAIN && errno != EINTR)) {
+            /* Process exited. */
             break;
          }
       }
-      close(fds[1]);
+      close(fds[0]);
       buffer[buffer_size] = 0;
       return buffer;
    }
 
+   close(fds[0]);
    return NULL;
 }
+
+/** Read the output of an external program without blocking. */
+void ReadFromProcessAsync(const char *command, unsigned timeout_ms,
+                          ProcessCallback callback, void *data)
+{
+   const unsigned BLOCK_SIZE = 256;
+   ProcessNode *pp;
+   pid_t pid;
+   int fds[2];
+
+   if(JUNLIKELY(!CreatePipe(fds))) {
+      (callback)(NULL, data);
+      return;
+   }
+   if(JUNLIKELY(fcntl(fds[0], F_SETFL, O_NONBLOCK) == -1)) {
+      /* Output is read until EAGAIN, which would block the event
+       * loop without O_NONBLOCK. */
+      Warning(_("could not set O_NONBLOCK"));
+      close(fds[0]);
+      close(fds[1]);
+      (callback)(NULL, data);
+      return;
+   }
+
+   /* Close our copy of the write end so we see EOF when the child
+    * exits. The child is reaped by the SIGCHLD handler. */
+   pid = SpawnCommand(command, fds[1]);
+   close(fds[1]);
+   if(pid < 0) {
+      close(fds[0]);
+      (callback)(NULL, data);
+      return;
+   }
+
+   pp = Allocate(sizeof(ProcessNode));
+   pp->command = CopyString(command);
+   pp->pid = pid;
+   pp->fd = fds[0];
+   pp->maxSize = BLOCK_SIZE;
+   pp->size = 0;
+   pp->buffer = Allocate(pp->maxSize);
+   pp->timeout = timeout_ms;
+   pp->callback = callback;
+   pp->data = data;
+   pp->next = processes;
+   processes = pp;
+
+   RegisterFileCallback(pp->fd, HandleProcessOutput, pp);
+   ScheduleCallback(timeout_ms, SignalProcessTimeout, pp);
+}
+
+/** Cancel reading from a process. */
+void CancelProcessRead(ProcessCallback callback, void *data)
+{
+   ProcessNode *pp = processes;
+   while(pp) {
+      ProcessNode *next = pp->next;
+      if(pp->callback == callback && pp->data == data) {
+         kill(pp->pid, SIGKILL);
+         CancelCallback(SignalProcessTimeout, pp);
+         Release(pp->buffer);
+         ReleaseProcess(pp);
+      }
+      pp = next;
+   }
+}
+
+/** Read available output from a process. */
+void HandleProcessOutput(int fd, void *data)
+{
+   const unsigned BLOCK_SIZE = 256;
+   ProcessNode *pp = (ProcessNode*)data;
+   ProcessCallback callback;
+   void *callbackData;
+   char *buffer;
+
+   for(;;) {
+      int rc;
+      if(pp->size + BLOCK_SIZE > pp->maxSize) {
+         pp->maxSize *= 2;
+         pp->buffer = Reallocate(pp->buffer, pp->maxSize);
+      }
+      rc = read(fd, &pp->buffer[pp->size], BLOCK_SIZE);
+      if(rc > 0) {
+         pp->size += rc;
+      } else if(rc < 0 && errno == EINTR) {
+         continue;
+      } else if(rc < 0 && errno == EAGAIN) {
+         return;
+      } else {
+         /* End of output. */
+         break;
+      }
+   }
+
+   pp->buffer[pp->size] = 0;
+   buffer = pp->buffer;
+   callback = pp->callback;
+   callbackData = pp->data;
+   CancelCallback(SignalProcessTimeout, pp);
+   ReleaseProcess(pp);
+   (callback)(buffer, callbackData);
+}
+
+/** Stop a process that did not finish in time. */
+void SignalProcessTimeout(const TimeType *now, int x, int y,
+                          Window w, void *data)
+{
+   ProcessNode *pp = (ProcessNode*)data;
+   ProcessCallback callback = pp->callback;
+   void *callbackData = pp->data;
+
+   Warning(_("timeout: %s did not complete in %u milliseconds"),
+           pp->command, pp->timeout);
+   kill(pp->pid, SIGKILL);
+   Release(pp->buffer);
+   ReleaseProcess(pp);
+   (callback)(NULL, callbackData);
+}
+
+/** Remove a process from the list and close its pipe.
+ * The buffer is not released.
+ */
+void ReleaseProcess(ProcessNode *pp)
+{
+   ProcessNode **lp;
+   for(lp = &processes; *lp; lp = &(*lp)->next) {
+      if(*lp == pp) {
+         *lp = pp->next;
+         break;
+      }
+   }
+   UnregisterFileCallback(pp->fd);
+   close(pp->fd);
+   Release(pp->command);
+   Release(pp);
+}
+
+/** Create a pipe that is not inherited by child processes.
+ * Returns 1 on success or 0 on failure.
+ */
+char CreatePipe(int fds[2])
+{
+   if(JUNLIKELY(pipe(fds))) {
+      Warning(_("could not create pipe"));
+      return 0;
+   }
+   fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+   fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+   return 1;
+}
+
+/** Start a process in its own session.
+ * If output is not -1, it becomes the standard output of the process.
+ * Returns the process ID or -1 on failure.
+ */
+pid_t SpawnCommand(const char *command, int output)
+{
+   char **argv = CreateArguments(command);
+   pid_t pid;
+
+   if(JUNLIKELY(!argv)) {
+      return -1;
+   }
+
+#ifdef USE_POSIX_SPAWN
+   {
+      posix_spawn_file_actions_t actions;
+      posix_spawnattr_t attr;
+      int rc;
+
+      posix_spawn_file_actions_init(&actions);
+      if(output >= 0) {
+         posix_spawn_file_actions_adddup2(&actions, output, 1);
+      }
+      posix_spawnattr_init(&attr);
+#  ifdef POSIX_SPAWN_SETSID
+      posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+#  else
+      posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+      posix_spawnattr_setpgroup(&attr, 0);
+#  endif
+      rc = posix_spawnp(&pid, argv[0], &actions, &attr, argv, environ);
+      posix_spawnattr_destroy(&attr);
+      posix_spawn_file_actions_destroy(&actions);
+      if(JUNLIKELY(rc)) {
+         Warning(_("exec failed: (%s) %s"), argv[0], command);
+         pid = -1;
+      }
+   }
+#else
+   pid = fork();
+   if(pid == 0) {
+      /* The child process. */
+      if(output >= 0) {
+         dup2(output, 1);  /* stdout */
+      }
+      setsid();
+      execvp(argv[0], argv);
+      Warning(_("exec failed: (%s) %s"), argv[0], command);
+      _exit(EXIT_FAILURE);
+   }
+#endif
+
+   Release(argv);
+   return pid;
+}
+
+/** Get the arguments to run a command.
+ * Commands without shell syntax are split on whitespace and run
+ * directly; anything else is passed to the shell. The result is a
+ * single allocation to be released with Release.
+ */
+char **CreateArguments(const char *command)
+{
+   static const char SHELL_CHARS[] = "|&;<>()$`\\\"'*?[]#~=%!{}\n";
+   const size_t len = strlen(command) + 1;
+   const char *cp;
+   char **argv;
+   char *str;
+   unsigned count;
+
+   if(strpbrk(command, SHELL_CHARS)) {
+      argv = Allocate(4 * sizeof(char*) + len);
+      str = (char*)&argv[4];
+      memcpy(str, command, len);
+      argv[0] = (char*)SHELL_NAME;
+      argv[1] = (char*)"-c";
+      argv[2] = str;
+      argv[3] = NULL;
+      return argv;
+   }
+
+   /* Count the words. */
+   count = 0;
+   cp = command;
+   for(;;) {
+      while(*cp == ' ' || *cp == '\t') {
+         cp += 1;
+      }
+      if(*cp == 0) {
+         break;
+      }
+      count += 1;
+      while(*cp && *cp != ' ' && *cp != '\t') {
+         cp += 1;
+      }
+   }
+   if(JUNLIKELY(count == 0)) {
+      return NULL;
+   }
+
+   /* Split the words in place. */
+   argv = Allocate((count + 1) * sizeof(char*) + len);
+   str = (char*)&argv[count + 1];
+   memcpy(str, command, len);
+   count = 0;
+   for(;;) {
+      while(*str == ' ' || *str == '\t') {
+         *str = 0;
+         str += 1;
+      }
+      if(*str == 0) {
+         break;
+      }
+      argv[count] = str;
+      count += 1;
+      while(*str && *str != ' ' && *str != '\t') {
+         str += 1;
+      }
+   }
+   argv[count] = NULL;
+   return argv;
+}
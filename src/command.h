@@ -44,5 +44,29 @@ void RunCommand(const char *command);
  */
 char *ReadFromProcess(const char *command, unsigned timeout_ms);
 
+/** Callback for output read with ReadFromProcessAsync.
+ * @param output The output (must be freed, NULL on failure or timeout).
+ * @param data Data passed to ReadFromProcessAsync.
+ */
+typedef void (*ProcessCallback)(char *output, void *data);
+
+/** Read output from a process without blocking.
+ * The output is collected from the event loop and passed to the
+ * callback once the process closes its output or the timeout expires.
+ * @param command The command to run (run in sh).
+ * @param timeout_ms The timeout in milliseconds.
+ * @param callback The callback to receive the output.
+ * @param data Data to pass to the callback.
+ */
+void ReadFromProcessAsync(const char *command, unsigned timeout_ms,
+                          ProcessCallback callback, void *data);
+
+/** Cancel reads started with ReadFromProcessAsync.
+ * The process is killed and the callback is not called.
+ * @param callback The callback passed to ReadFromProcessAsync.
+ * @param data The data passed to ReadFromProcessAsync.
+ */
+void CancelProcessRead(ProcessCallback callback, void *data);
+
 #endif /* COMMAND_H */
 
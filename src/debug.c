@@ -11,6 +11,9 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#ifdef USE_PTHREAD
+#  include <pthread.h>
+#endif
 
 /** Emit a message (if compiled with -DDEBUG). */
 void Debug(const char *str, ...)
@@ -42,6 +45,17 @@ typedef struct MemoryType {
 
 static MemoryType *allocations = NULL;
 
+/* Images may be loaded by other threads, so the allocation list
+ * needs to be protected. */
+#ifdef USE_PTHREAD
+static pthread_mutex_t allocationMutex = PTHREAD_MUTEX_INITIALIZER;
+#  define LockAllocations()   pthread_mutex_lock(&allocationMutex)
+#  define UnlockAllocations() pthread_mutex_unlock(&allocationMutex)
+#else
+#  define LockAllocations()   (void)(0)
+#  define UnlockAllocations() (void)(0)
+#endif
+
 static const char *checkpointFile[CHECKPOINT_LIST_SIZE];
 static unsigned int checkpointLine[CHECKPOINT_LIST_SIZE];
 static unsigned int checkpointOffset;
@@ -127,8 +141,10 @@ void *DEBUG_Allocate(size_t size, const char *file, unsigned int line)
    mp->pointer[7] = 42;
    mp->pointer[size + 8] = 42;
 
+   LockAllocations();
    mp->next = allocations;
    allocations = mp;
+   UnlockAllocations();
    return mp->pointer + 8;
 }
 
@@ -144,6 +160,7 @@ void *DEBUG_Reallocate(void *ptr, size_t size,
       return DEBUG_Allocate(size, file, line);
    } else {
       char *cptr = (char*)ptr - 8;
+      LockAllocations();
       for(mp = allocations; mp; mp = mp->next) {
          if(mp->pointer == cptr) {
             if(cptr[mp->size + 8] != 42) {
@@ -165,9 +182,11 @@ void *DEBUG_Reallocate(void *ptr, size_t size,
             }
             mp->pointer[7] = 42;
             mp->pointer[size + 8] = 42;
+            UnlockAllocations();
             return mp->pointer + 8;
          }
       }
+      UnlockAllocations();
 
       Debug("MEMORY: %s[%u]: Attempt to reallocate unallocated pointer",
             file, line);
@@ -185,8 +204,10 @@ void *DEBUG_Reallocate(void *ptr, size_t size,
       memset(mp->pointer, 85, size);
       mp->pointer[7] = 42;
       mp->pointer[size + 8] = 42;
+      LockAllocations();
       mp->next = allocations;
       allocations = mp;
+      UnlockAllocations();
       return mp->pointer + 8;
    }
 }
@@ -203,6 +224,7 @@ void DEBUG_Release(void **ptr, const char *file, unsigned int line)
    } else {
       char *cptr = (char*)*ptr - 8;
       last = NULL;
+      LockAllocations();
       for(mp = allocations; mp; mp = mp->next) {
          if(mp->pointer == cptr) {
             if(last) {
@@ -210,6 +232,7 @@ void DEBUG_Release(void **ptr, const char *file, unsigned int line)
             } else {
                allocations = mp->next;
             }
+            UnlockAllocations();
 
             if(cptr[mp->size + 8] != 42) {
                Debug("MEMORY: %s[%u]: The canary is dead (overflow).",
@@ -228,6 +251,7 @@ void DEBUG_Release(void **ptr, const char *file, unsigned int line)
          }
          last = mp;
       }
+      UnlockAllocations();
       Debug("MEMORY: %s[%u]: Attempt to delete unallocated pointer",
             file, line);
       free(*ptr);
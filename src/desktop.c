@@ -155,7 +155,10 @@ void ChangeDesktop(unsigned int desktop)
 {
 
    ClientNode *np;
-   unsigned int x;
+#ifdef DEBUG
+   struct timeval start, stop;
+   unsigned int touched = 0;
+#endif
 
    if(JUNLIKELY(desktop >= settings.desktopCount)) {
       return;
@@ -165,43 +168,55 @@ void ChangeDesktop(unsigned int desktop)
       return;
    }
 
+#ifdef DEBUG
+   gettimeofday(&start, NULL);
+#endif
+
+   /* The switch is done as a single batch of requests: nothing below
+    * waits on the server, so everything goes out in one flush at the
+    * end, including the new background and stacking order.
+    */
+
    /* Hide clients from the old desktop.
     * Note that we show clients in a separate loop to prevent an issue
     * with clients losing focus.
+    * Sticky clients are not in the desktop lists.
     */
-   for(x = 0; x < LAYER_COUNT; x++) {
-      for(np = nodes[x]; np; np = np->next) {
-         if(np->state.status & STAT_STICKY) {
-            continue;
-         }
-         if(np->state.desktop == currentDesktop) {
-            HideClient(np);
-         }
-      }
+   for(np = GetDesktopClients(currentDesktop); np; np = np->desktopNext) {
+      HideClient(np);
+#ifdef DEBUG
+      touched += 1;
+#endif
    }
 
+   LoadBackground(desktop);
+
    /* Show clients on the new desktop. */
-   for(x = 0; x < LAYER_COUNT; x++) {
-      for(np = nodes[x]; np; np = np->next) {
-         if(np->state.status & STAT_STICKY) {
-            continue;
-         }
-         if(np->state.desktop == desktop) {
-            ShowClient(np);
-         }
-      }
+   for(np = GetDesktopClients(desktop); np; np = np->desktopNext) {
+      ShowClient(np);
+#ifdef DEBUG
+      touched += 1;
+#endif
    }
 
+   RestackClients();
+
    currentDesktop = desktop;
 
    SetCardinalAtom(rootWindow, ATOM_NET_CURRENT_DESKTOP, currentDesktop);
    SetCardinalAtom(rootWindow, ATOM_NET_SHOWING_DESKTOP,
                    showingDesktop[currentDesktop]);
 
-   RequireRestack();
-   RequireTaskUpdate();
+   JXFlush(display);
 
-   LoadBackground(desktop);
+#ifdef DEBUG
+   gettimeofday(&stop, NULL);
+   Debug("ChangeDesktop: %u of %u clients in %ld us", touched, clientCount,
+         (long)(stop.tv_sec - start.tv_sec) * 1000000L
+            + (long)(stop.tv_usec - start.tv_usec));
+#endif
+
+   RequireTaskUpdate();
 
 }
 
@@ -270,27 +285,23 @@ void ShowDesktop(void)
    int layer;
 
    GrabServer();
-   for(layer = 0; layer < LAYER_COUNT; layer++) {
-      for(np = nodes[layer]; np; np = np->next) {
-         if(np->state.status & STAT_NOLIST) {
-            continue;
+   for(np = GetFirstVisibleClient(currentDesktop); np;
+       np = GetNextVisibleClient(np)) {
+      if(np->state.status & STAT_NOLIST) {
+         continue;
+      }
+      if(showingDesktop[currentDesktop]) {
+         if(np->state.status & STAT_SDESKTOP) {
+            RestoreClient(np, 0);
          }
-         if((np->state.desktop == currentDesktop) ||
-            (np->state.status & STAT_STICKY)) {
-            if(showingDesktop[currentDesktop]) {
-               if(np->state.status & STAT_SDESKTOP) {
-                  RestoreClient(np, 0);
-               }
-            } else {
-               if(np->state.status & STAT_ACTIVE) {
-                  JXSetInputFocus(display, rootWindow, RevertToParent,
-                                  CurrentTime);
-               }
-               if(np->state.status & (STAT_MAPPED | STAT_SHADED)) {
-                  MinimizeClient(np, 0);
-                  np->state.status |= STAT_SDESKTOP;
-               }
-            }
+      } else {
+         if(np->state.status & STAT_ACTIVE) {
+            JXSetInputFocus(display, rootWindow, RevertToParent,
+                            CurrentTime);
+         }
+         if(np->state.status & (STAT_MAPPED | STAT_SHADED)) {
+            MinimizeClient(np, 0);
+            np->state.status |= STAT_SDESKTOP;
          }
       }
    }
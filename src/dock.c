@@ -128,6 +128,7 @@ void ShutdownDock(void)
 
       /* Destroy the dock window. */
       JXDestroyWindow(display, dock->window);
+      ForgetWindowProperties(dock->window);
 
    }
 
@@ -30,7 +30,9 @@
 #include "tray.h"
 #include "popup.h"
 #include "pager.h"
+#include "thumbnail.h"
 #include "grab.h"
+#include "misc.h"
 
 #define MIN_TIME_DELTA 50
 
@@ -46,11 +48,35 @@ typedef struct CallbackNode {
 
 static CallbackNode *callbacks = NULL;
 
+/** One-shot callbacks (see ScheduleCallback).
+ * For these, last is the time the callback was scheduled and freq
+ * is the delay. */
+static CallbackNode *timers = NULL;
+
+/** File descriptors watched while waiting for events. */
+typedef struct FileNode {
+   int fd;
+   FileCallback callback;
+   void *data;
+   struct FileNode *next;
+} FileNode;
+
+static FileNode *files = NULL;
+
 static char restack_pending = 0;
 static char task_update_pending = 0;
 static char pager_update_pending = 0;
+static char client_list_pending = 0;
+
+/** Client window to focus once the mouse rests (sloppy focus). */
+static Window pendingFocus = None;
+static TimeType pendingFocusTime;
 
 static void Signal(void);
+static void RunTimers(const TimeType *now);
+static long GetTimerDelay(long maxDelay);
+static char CommitPendingFocus(long *wait);
+static void RunFileCallbacks(const fd_set *fds);
 
 static void ProcessBinding(MouseContextType context, ClientNode *np,
                            unsigned state, int code, int x, int y);
@@ -96,6 +122,8 @@ char WaitForEvent(XEvent *event)
    fd_set fds;
    long sleepTime;
    int fd;
+   int maxfd;
+   FileNode *fp;
    char handled;
 
 #ifdef ConnectionNumber
@@ -115,12 +143,26 @@ char WaitForEvent(XEvent *event)
    do {
 
       while(JXPending(display) == 0) {
+         long wait = GetTimerDelay(sleepTime);
+         if(CommitPendingFocus(&wait)) {
+            /* Apply the updates from the focus change and flush them
+             * (JXPending flushes) before blocking. */
+            Signal();
+            continue;
+         }
          FD_ZERO(&fds);
          FD_SET(fd, &fds);
-         timeout.tv_sec = sleepTime / 1000;
-         timeout.tv_usec = (sleepTime % 1000) * 1000;
-         if(select(fd + 1, &fds, NULL, NULL, &timeout) <= 0) {
+         maxfd = fd;
+         for(fp = files; fp; fp = fp->next) {
+            FD_SET(fp->fd, &fds);
+            maxfd = Max(maxfd, fp->fd);
+         }
+         timeout.tv_sec = wait / 1000;
+         timeout.tv_usec = (wait % 1000) * 1000;
+         if(select(maxfd + 1, &fds, NULL, NULL, &timeout) <= 0) {
             Signal();
+         } else if(files) {
+            RunFileCallbacks(&fds);
          }
          if(JUNLIKELY(shouldExit)) {
             return 0;
@@ -208,6 +250,12 @@ char WaitForEvent(XEvent *event)
          } else if(haveShape && event->type == shapeEvent) {
             HandleShapeEvent((XShapeEvent*)event);
             handled = 1;
+#endif
+#ifdef USE_COMPOSITE
+         } else if(haveComposite
+                   && event->type == damageEvent + XDamageNotify) {
+            HandleDamageNotify((XDamageNotifyEvent*)event);
+            handled = 1;
 #endif
          } else {
             handled = 0;
@@ -256,8 +304,13 @@ void Signal(void)
       UpdatePager();
       pager_update_pending = 0;
    }
+   if(client_list_pending) {
+      UpdateNetClientList();
+      client_list_pending = 0;
+   }
 
    GetCurrentTime(&now);
+   RunTimers(&now);
    if(GetTimeDifference(&now, &last) < MIN_TIME_DELTA) {
       return;
    }
@@ -272,15 +325,107 @@ void Signal(void)
    }
 }
 
+/** Run one-shot callbacks that are due. */
+void RunTimers(const TimeType *now)
+{
+   CallbackNode **cp;
+   Window w;
+   int x, y;
+
+   if(timers == NULL) {
+      return;
+   }
+
+   GetMousePosition(&x, &y, &w);
+   cp = &timers;
+   while(*cp) {
+      CallbackNode *tp = *cp;
+      if(GetTimeDifference(now, &tp->last) >= tp->freq) {
+
+         /* Remove the timer before running it since the callback
+          * may schedule itself again. Start over when done. */
+         *cp = tp->next;
+         (tp->callback)(now, x, y, w, tp->data);
+         Release(tp);
+         cp = &timers;
+
+      } else {
+         cp = &tp->next;
+      }
+   }
+}
+
+/** Get the time in milliseconds until the next one-shot callback.
+ * Returns maxDelay if nothing is due before then.
+ */
+long GetTimerDelay(long maxDelay)
+{
+   CallbackNode *cp;
+   TimeType now;
+   long result = maxDelay;
+
+   if(timers == NULL) {
+      return result;
+   }
+
+   GetCurrentTime(&now);
+   for(cp = timers; cp; cp = cp->next) {
+      const unsigned long elapsed = GetTimeDifference(&now, &cp->last);
+      const long remaining = elapsed >= cp->freq ? 0 : cp->freq - elapsed;
+      if(remaining < result) {
+         result = remaining;
+      }
+   }
+   return result;
+}
+
+/** Apply a pending sloppy focus change.
+ * This is called when the event queue is empty. Focus is given to the
+ * window under the mouse once the mouse has rested for the focus delay,
+ * so windows that are only passed over never receive focus.
+ * If the change is not yet due, wait is reduced to the number of
+ * milliseconds until it is. Returns 1 if focus was changed.
+ */
+char CommitPendingFocus(long *wait)
+{
+   ClientNode *np;
+   TimeType now;
+   unsigned long elapsed;
+
+   if(pendingFocus == None) {
+      return 0;
+   }
+
+   GetCurrentTime(&now);
+   elapsed = GetTimeDifference(&now, &pendingFocusTime);
+   if(elapsed < settings.focusDelay) {
+      const long remaining = settings.focusDelay - elapsed;
+      *wait = Min(*wait, remaining);
+      return 0;
+   }
+
+   np = FindClientByWindow(pendingFocus);
+   pendingFocus = None;
+   if(np && !(np->state.status & STAT_ACTIVE)) {
+      Debug("sloppy focus committed %lu ms after the mouse rested", elapsed);
+      FocusClient(np);
+      return 1;
+   }
+   return 0;
+
+}
+
 /** Process an event. */
 void ProcessEvent(XEvent *event)
 {
    switch(event->type) {
    case ButtonPress:
    case ButtonRelease:
+      pendingFocus = None;
       HandleButtonEvent(&event->xbutton);
       break;
    case KeyPress:
+      pendingFocus = None;
       HandleKeyPress(&event->xkey);
       break;
    case KeyRelease:
@@ -872,11 +1017,21 @@ void HandleEnterNotify(const XCrossingEvent *event)
    ClientNode *np;
    Cursor cur;
    np = FindClient(event->window);
+
+   /* Focus changes for sloppy focus are deferred until the mouse rests
+    * (see CommitPendingFocus). Entering another window replaces any
+    * change that is still pending. */
+   if(!np || pendingFocus != np->window) {
+      pendingFocus = None;
+   }
+
    if(np) {
       if(  !(np->state.status & STAT_ACTIVE)
+         && pendingFocus == None
          && (settings.focusModel == FOCUS_SLOPPY
             || settings.focusModel == FOCUS_SLOPPY_TITLE)) {
-         FocusClient(np);
+         pendingFocus = np->window;
+         GetCurrentTime(&pendingFocusTime);
       }
       if(np->parent == event->window) {
          np->mouseContext = GetBorderContext(np, event->x, event->y);
@@ -938,13 +1093,9 @@ char HandlePropertyNotify(const XPropertyEvent *event)
          changed = 1;
          break;
       case XA_WM_HINTS:
-         if(np->state.status & STAT_URGENT) {
-            UnregisterCallback(SignalUrgent, np);
-         }
+         UnregisterUrgentClient(np);
          ReadWMHints(np->window, &np->state, 1);
-         if(np->state.status & STAT_URGENT) {
-            RegisterCallback(URGENCY_DELAY, SignalUrgent, np);
-         }
+         RegisterUrgentClient(np);
          WriteState(np);
          break;
       case XA_WM_TRANSIENT_FOR:
@@ -1051,6 +1202,7 @@ void HandleClientMessage(const XClientMessageEvent *event)
             if(   event->data.l[0] >= 0
                && event->data.l[0] < (long)settings.desktopCount) {
                np->state.status &= ~STAT_STICKY;
+               UpdateDesktopList(np);
                SetClientDesktop(np, event->data.l[0]);
             }
          }
@@ -1469,6 +1621,12 @@ void HandleFrameExtentsRequest(const XClientMessageEvent *event)
    ClientState state;
    state = ReadWindowState(event->window, 0);
    WriteFrameExtents(event->window, &state);
+
+   /* The window is not managed yet, so nothing would drop the cached
+    * write if it is destroyed (and its XID is reused). */
+   if(!FindClientByWindow(event->window)) {
+      ForgetWindowProperties(event->window);
+   }
 }
 
 /** Handle a motion notify event. */
@@ -1478,11 +1636,17 @@ void HandleMotionNotify(const XMotionEvent *event)
    ClientNode *np;
    Cursor cur;
 
+   np = FindClientByParent(event->window);
+
+   /* The focus delay starts over while the mouse is moving. */
+   if(np && np->window == pendingFocus) {
+      GetCurrentTime(&pendingFocusTime);
+   }
+
    if(event->is_hint) {
       return;
    }
 
-   np = FindClientByParent(event->window);
    if(np) {
       const MouseContextType context = GetBorderContext(np, event->x, event->y);
       if(np->mouseContext != context) {
@@ -1550,6 +1714,7 @@ void HandleMapRequest(const XMapEvent *event)
          }
          if(!(np->state.status & STAT_STICKY)) {
             np->state.desktop = currentDesktop;
+            UpdateDesktopList(np);
          }
          if(!(np->state.status & STAT_NOFOCUS)) {
             FocusClient(np);
@@ -1581,6 +1746,12 @@ void HandleUnmapNotify(const XUnmapEvent *event)
    np = FindClientByWindow(event->window);
    if(np) {
 
+      /* Discard events caused by UnmapClient. */
+      if(np->ignoreUnmap > 0 && !event->send_event) {
+         np->ignoreUnmap -= 1;
+         return;
+      }
+
       /* Grab the server to prevent the client from destroying the
        * window after we check for a DestroyNotify. */
       GrabServer();
@@ -1645,13 +1816,12 @@ void UpdateState(ClientNode *np)
    }
 
    /* Read the state (and new layer). */
-   if(np->state.status & STAT_URGENT) {
-      UnregisterCallback(SignalUrgent, np);
-   }
+   UnregisterUrgentClient(np);
    np->state = ReadWindowState(np->window, alreadyMapped);
-   if(np->state.status & STAT_URGENT) {
-      RegisterCallback(URGENCY_DELAY, SignalUrgent, np);
-   }
+   RegisterUrgentClient(np);
+
+   /* The sticky state and desktop may have changed. */
+   UpdateDesktopList(np);
 
    /* We don't handle mapping the window, so restore its mapped state. */
    if(!alreadyMapped) {
@@ -1717,6 +1887,46 @@ void UpdateTime(const XEvent *event)
    }
 }
 
+/** Run callbacks for file descriptors that are ready. */
+void RunFileCallbacks(const fd_set *fds)
+{
+   FileNode *fp = files;
+   while(fp) {
+      FileNode *next = fp->next;
+      if(FD_ISSET(fp->fd, fds)) {
+         /* The callback may unregister itself. */
+         (fp->callback)(fp->fd, fp->data);
+      }
+      fp = next;
+   }
+}
+
+/** Watch a file descriptor while waiting for events. */
+void RegisterFileCallback(int fd, FileCallback callback, void *data)
+{
+   FileNode *fp = Allocate(sizeof(FileNode));
+   fp->fd = fd;
+   fp->callback = callback;
+   fp->data = data;
+   fp->next = files;
+   files = fp;
+}
+
+/** Stop watching a file descriptor. */
+void UnregisterFileCallback(int fd)
+{
+   FileNode **fp;
+   for(fp = &files; *fp; fp = &(*fp)->next) {
+      if((*fp)->fd == fd) {
+         FileNode *temp = *fp;
+         *fp = (*fp)->next;
+         Release(temp);
+         return;
+      }
+   }
+   Assert(0);
+}
+
 /** Register a callback. */
 void RegisterCallback(int freq, SignalCallback callback, void *data)
 {
@@ -1746,6 +1956,36 @@ void UnregisterCallback(SignalCallback callback, void *data)
    Assert(0);
 }
 
+/** Run a callback once after a delay. */
+void ScheduleCallback(int delay, SignalCallback callback, void *data)
+{
+   CallbackNode *cp;
+
+   CancelCallback(callback, data);
+
+   cp = Allocate(sizeof(CallbackNode));
+   GetCurrentTime(&cp->last);
+   cp->freq = delay;
+   cp->callback = callback;
+   cp->data = data;
+   cp->next = timers;
+   timers = cp;
+}
+
+/** Cancel a callback scheduled with ScheduleCallback. */
+void CancelCallback(SignalCallback callback, void *data)
+{
+   CallbackNode **cp;
+   for(cp = &timers; *cp; cp = &(*cp)->next) {
+      if((*cp)->callback == callback && (*cp)->data == data) {
+         CallbackNode *temp = *cp;
+         *cp = (*cp)->next;
+         Release(temp);
+         return;
+      }
+   }
+}
+
 /** Restack clients before waiting for an event. */
 void RequireRestack()
 {
@@ -1763,3 +2003,9 @@ void RequirePagerUpdate()
 {
    pager_update_pending = 1;
 }
+
+/** Update the _NET_CLIENT_LIST properties before waiting for an event. */
+void RequireClientListUpdate()
+{
+   client_list_pending = 1;
+}
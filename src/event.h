@@ -63,6 +63,42 @@ void RegisterCallback(int freq, SignalCallback callback, void *data);
  */
 void UnregisterCallback(SignalCallback callback, void *data);
 
+/** Run a callback once after a delay.
+ * This replaces any pending run of the same callback and data.
+ * The callback may schedule itself again.
+ * @param delay The delay in milliseconds.
+ * @param callback The callback function.
+ * @param data Data to pass to the callback.
+ */
+void ScheduleCallback(int delay, SignalCallback callback, void *data);
+
+/** Cancel a callback scheduled with ScheduleCallback.
+ * Nothing happens if the callback is not scheduled.
+ * @param callback The callback function.
+ * @param data Data passed to ScheduleCallback.
+ */
+void CancelCallback(SignalCallback callback, void *data);
+
+/** Callback for a file descriptor that is ready to read.
+ * @param fd The file descriptor.
+ * @param data Data passed to RegisterFileCallback.
+ */
+typedef void (*FileCallback)(int fd, void *data);
+
+/** Watch a file descriptor while waiting for events.
+ * The callback is run from WaitForEvent when the descriptor is ready
+ * to read, so input can be handled without blocking.
+ * @param fd The file descriptor.
+ * @param callback The callback function.
+ * @param data Data to pass to the callback.
+ */
+void RegisterFileCallback(int fd, FileCallback callback, void *data);
+
+/** Stop watching a file descriptor.
+ * @param fd The file descriptor passed to RegisterFileCallback.
+ */
+void UnregisterFileCallback(int fd);
+
 /** Restack clients before waiting for an event. */
 void RequireRestack();
 
@@ -72,5 +108,8 @@ void RequireTaskUpdate();
 /** Update the pager before waiting for an event. */
 void RequirePagerUpdate();
 
+/** Update the _NET_CLIENT_LIST properties before waiting for an event. */
+void RequireClientListUpdate();
+
 #endif /* EVENT_H */
 
@@ -344,7 +344,7 @@ void ApplyGroup(const GroupType *gp, ClientNode *np)
          }
          break;
       case OPTION_ICON:
-         DestroyIcon(np->icon);
+         DestroyClientIcon(np);
          np->icon = LoadNamedIcon(lp->str, 1, 1);
          break;
       case OPTION_PIGNORE:
@@ -176,8 +176,36 @@ static const AtomNode atomList[] = {
 
 };
 
+/** Number of buckets in the property cache (must be a power of 2). */
+#define PROPERTY_HASH_SIZE 64
+
+/** Maximum number of values stored in the property cache. */
+#define MAX_PROPERTY_VALUES 16
+
+/** The last value written to a window property.
+ * This allows us to avoid writing a property if it did not change,
+ * since every write wakes up everything listening to the window.
+ */
+typedef struct PropertyNode {
+   Window window;                /**< The window. */
+   AtomType atom;                /**< The property. */
+   Atom type;                    /**< The property type. */
+   int count;                    /**< Number of values (-1 if unknown). */
+   char deleted;                 /**< Set if the property was deleted. */
+   unsigned long values[MAX_PROPERTY_VALUES];
+   struct PropertyNode *next;    /**< Next node in the hash bucket. */
+} PropertyNode;
+
+static PropertyNode *propertyHash[PROPERTY_HASH_SIZE];
+static unsigned long skippedWrites;
+
 static char CheckShape(Window win);
 static void WriteNetAllowed(ClientNode *np);
+static PropertyNode *FindProperty(Window win, AtomType atom, char create);
+static void ChangeProperty(Window win, AtomType atom, Atom type,
+                           const unsigned long *values, int count);
+static void DeleteProperty(Window win, AtomType atom);
+static void ForgetProperty(Window win, AtomType atom);
 static void ReadWMState(Window win, ClientState *state);
 static void ReadMotifHints(Window win, ClientState *state);
 
@@ -192,6 +220,9 @@ void StartupHints(void)
    unsigned int x;
    unsigned int count;
 
+   memset(propertyHash, 0, sizeof(propertyHash));
+   skippedWrites = 0;
+
    /* Determine how much space we will need on the stack and allocate it. */
    count = 0;
    for(x = 0; x < settings.desktopCount; x++) {
@@ -270,6 +301,107 @@ void StartupHints(void)
 
 }
 
+/** Release the property cache. */
+void ShutdownHints(void)
+{
+   unsigned int x;
+   for(x = 0; x < PROPERTY_HASH_SIZE; x++) {
+      while(propertyHash[x]) {
+         PropertyNode *pp = propertyHash[x]->next;
+         Release(propertyHash[x]);
+         propertyHash[x] = pp;
+      }
+   }
+   Debug("skipped %lu redundant property writes", skippedWrites);
+}
+
+/** Forget the cached properties of a window. */
+void ForgetWindowProperties(Window win)
+{
+   PropertyNode **ppp;
+   ppp = &propertyHash[(win ^ (win >> 8)) & (PROPERTY_HASH_SIZE - 1)];
+   while(*ppp) {
+      if((*ppp)->window == win) {
+         PropertyNode *pp = *ppp;
+         *ppp = pp->next;
+         Release(pp);
+      } else {
+         ppp = &(*ppp)->next;
+      }
+   }
+}
+
+/** Forget the cached value of a window property.
+ * The next write goes to the server even if the value is unchanged.
+ */
+void ForgetProperty(Window win, AtomType atom)
+{
+   PropertyNode *pp = FindProperty(win, atom, 0);
+   if(pp) {
+      pp->count = -1;
+      pp->deleted = 0;
+   }
+}
+
+/** Find the cache entry for a window property. */
+PropertyNode *FindProperty(Window win, AtomType atom, char create)
+{
+   const unsigned int index = (win ^ (win >> 8)) & (PROPERTY_HASH_SIZE - 1);
+   PropertyNode *pp;
+   for(pp = propertyHash[index]; pp; pp = pp->next) {
+      if(pp->window == win && pp->atom == atom) {
+         return pp;
+      }
+   }
+   if(create) {
+      pp = Allocate(sizeof(PropertyNode));
+      pp->window = win;
+      pp->atom = atom;
+      pp->count = -1;
+      pp->deleted = 0;
+      pp->next = propertyHash[index];
+      propertyHash[index] = pp;
+   }
+   return pp;
+}
+
+/** Write a 32-bit property if it differs from the last value written. */
+void ChangeProperty(Window win, AtomType atom, Atom type,
+                    const unsigned long *values, int count)
+{
+   PropertyNode *pp = FindProperty(win, atom, count <= MAX_PROPERTY_VALUES);
+   if(pp && pp->count == count && pp->type == type
+      && !memcmp(pp->values, values, count * sizeof(unsigned long))) {
+      skippedWrites += 1;
+      return;
+   }
+   JXChangeProperty(display, win, atoms[atom], type, 32, PropModeReplace,
+                    (const unsigned char*)values, count);
+   if(pp) {
+      pp->deleted = 0;
+      if(count <= MAX_PROPERTY_VALUES) {
+         pp->type = type;
+         pp->count = count;
+         memcpy(pp->values, values, count * sizeof(unsigned long));
+      } else {
+         pp->count = -1;
+      }
+   }
+}
+
+/** Delete a property unless it was already deleted. */
+void DeleteProperty(Window win, AtomType atom)
+{
+   PropertyNode *pp = FindProperty(win, atom, 1);
+   if(pp->deleted) {
+      skippedWrites += 1;
+      return;
+   }
+   JXDeleteProperty(display, win, atoms[atom]);
+   pp->deleted = 1;
+   pp->count = -1;
+}
+
 /** Determine the current desktop. */
 void ReadCurrentDesktop(void)
 {
@@ -343,11 +475,10 @@ void WriteState(ClientNode *np)
    data[1] = None;
 
    if(data[0] == WithdrawnState) {
-      JXDeleteProperty(display, np->window, atoms[ATOM_WM_STATE]);
+      DeleteProperty(np->window, ATOM_WM_STATE);
    } else {
-      JXChangeProperty(display, np->window, atoms[ATOM_WM_STATE],
-                       atoms[ATOM_WM_STATE], 32, PropModeReplace,
-                       (unsigned char*)data, 2);
+      ChangeProperty(np->window, ATOM_WM_STATE, atoms[ATOM_WM_STATE],
+                     data, 2);
    }
 
    WriteNetState(np);
@@ -365,8 +496,12 @@ void SetOpacity(ClientNode *np, unsigned int opacity, char force)
 
    w = np->parent != None ? np->parent : np->window;
    np->state.opacity = opacity;
+   if(force) {
+      /* The property may have been changed by someone else. */
+      ForgetProperty(w, ATOM_NET_WM_WINDOW_OPACITY);
+   }
    if(opacity == 0xFFFFFFFF) {
-      JXDeleteProperty(display, w, atoms[ATOM_NET_WM_WINDOW_OPACITY]);
+      DeleteProperty(w, ATOM_NET_WM_WINDOW_OPACITY);
    } else {
       SetCardinalAtom(w, ATOM_NET_WM_WINDOW_OPACITY, opacity);
    }
@@ -382,8 +517,8 @@ void WriteNetState(ClientNode *np)
 
    /* We remove the _NET_WM_STATE and _NET_WM_DESKTOP for withdrawn windows. */
    if(!(np->state.status & (STAT_MAPPED | STAT_MINIMIZED | STAT_SHADED))) {
-      JXDeleteProperty(display, np->window, atoms[ATOM_NET_WM_STATE]);
-      JXDeleteProperty(display, np->window, atoms[ATOM_NET_WM_DESKTOP]);
+      DeleteProperty(np->window, ATOM_NET_WM_STATE);
+      DeleteProperty(np->window, ATOM_NET_WM_DESKTOP);
       return;
    } 
 
@@ -446,9 +581,7 @@ void WriteNetState(ClientNode *np)
       values[index++] = atoms[ATOM_NET_WM_STATE_FOCUSED];
    }
 
-   JXChangeProperty(display, np->window, atoms[ATOM_NET_WM_STATE],
-                    XA_ATOM, 32, PropModeReplace,
-                    (unsigned char*)values, index);
+   ChangeProperty(np->window, ATOM_NET_WM_STATE, XA_ATOM, values, index);
 }
 
 /** Set _NET_FRAME_EXTENTS. */
@@ -465,9 +598,7 @@ void WriteFrameExtents(Window win, const ClientState *state)
    values[2] = north;
    values[3] = south;
 
-   JXChangeProperty(display, win, atoms[ATOM_NET_FRAME_EXTENTS],
-                    XA_CARDINAL, 32, PropModeReplace,
-                    (unsigned char*)values, 4);
+   ChangeProperty(win, ATOM_NET_FRAME_EXTENTS, XA_CARDINAL, values, 4);
 
 }
 
@@ -516,9 +647,8 @@ void WriteNetAllowed(ClientNode *np)
    values[index++] = atoms[ATOM_NET_WM_ACTION_BELOW];
    values[index++] = atoms[ATOM_NET_WM_ACTION_ABOVE];
 
-   JXChangeProperty(display, np->window, atoms[ATOM_NET_WM_ALLOWED_ACTIONS],
-                    XA_ATOM, 32, PropModeReplace,
-                    (unsigned char*)values, index);
+   ChangeProperty(np->window, ATOM_NET_WM_ALLOWED_ACTIONS, XA_ATOM,
+                  values, index);
 
 }
 
@@ -1144,8 +1274,7 @@ char GetCardinalAtom(Window window, AtomType atom, unsigned long *value)
 void SetCardinalAtom(Window window, AtomType atom, unsigned long value)
 {
    Assert(window != None);
-   JXChangeProperty(display, window, atoms[atom], XA_CARDINAL, 32,
-                    PropModeReplace, (unsigned char*)&value, 1);
+   ChangeProperty(window, atom, XA_CARDINAL, &value, 1);
 }
 
 /** Read a window atom. */
@@ -1184,8 +1313,7 @@ char GetWindowAtom(Window window, AtomType atom, Window *value)
 void SetWindowAtom(Window window, AtomType atom, unsigned long value)
 {
    Assert(window != None);
-   JXChangeProperty(display, window, atoms[atom], XA_WINDOW, 32,
-                    PropModeReplace, (unsigned char*)&value, 1);
+   ChangeProperty(window, atom, XA_WINDOW, &value, 1);
 }
 
 /** Set a pixmap atom. */
@@ -1199,7 +1327,7 @@ void SetPixmapAtom(Window window, AtomType atom, Pixmap value)
 /** Set an atom atom. */
 void SetAtomAtom(Window window, AtomType atom, AtomType value)
 {
+   const unsigned long temp = atoms[value];
    Assert(window != None);
-   JXChangeProperty(display, window, atoms[atom], XA_ATOM, 32,
-                    PropModeReplace, (unsigned char*)&atoms[value], 1);
+   ChangeProperty(window, atom, XA_ATOM, &temp, 1);
 }
@@ -175,10 +175,18 @@ extern Atom atoms[ATOM_COUNT];
 /*@{*/
 #define InitializeHints()  (void)(0)
 void StartupHints(void);
-#define ShutdownHints()    (void)(0)
+void ShutdownHints(void);
 #define DestroyHints()     (void)(0)
 /*@}*/
 
+/** Forget the properties written to a window.
+ * Properties written through this module are cached so that they are
+ * only written when they change. This must be called when a window is
+ * destroyed or no longer managed.
+ * @param win The window.
+ */
+void ForgetWindowProperties(Window win);
+
 /** Determine the current desktop. */
 void ReadCurrentDesktop(void);
 
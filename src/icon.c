@@ -18,6 +18,7 @@
 #include "color.h"
 #include "settings.h"
 #include "border.h"
+#include "shm.h"
 
 IconNode emptyIcon;
 
@@ -26,6 +27,9 @@ IconNode emptyIcon;
 /* Must be a power of two. */
 #define HASH_SIZE 128
 
+/** Number of values to read at a time when hashing _NET_WM_ICON. */
+#define NET_WM_ICON_CHUNK 16384
+
 /** Linked list of icon paths. */
 typedef struct IconPathNode {
    char *path;
@@ -62,23 +66,30 @@ static const unsigned EXTENSION_COUNT = ARRAY_LENGTH(ICON_EXTENSIONS);
 static const unsigned MAX_EXTENSION_LENGTH = 5;
 
 static IconNode **iconHash;
+static IconNode **windowIconHash;
 static IconPathNode *iconPaths;
 static IconPathNode *iconPathsTail;
 static GC iconGC;
 static char iconSizeSet = 0;
 static char *defaultIconName;
 
-static void DoDestroyIcon(int index, IconNode *icon);
+static void DoDestroyIcon(IconNode **bucket, IconNode *icon);
 static IconNode *ReadNetWMIcon(Window win);
+static IconNode *InternNetWMIcon(IconNode *icon, Window win);
+static void ReleaseNetWMIcon(IconNode *icon, Window win);
+static char HashNetWMIcon(IconNode *icon, Window win, unsigned long length);
+static IconNode **GetNetWMIconBucket(const IconNode *icon);
 static IconNode *ReadWMHintIcon(Window win);
 static IconNode *CreateIcon(const ImageNode *image);
 static IconNode *CreateIconFromDrawable(Drawable d, Pixmap mask);
-static IconNode *CreateIconFromBinary(const unsigned long *data,
-                                      unsigned int length);
+static ImageNode *ReadNetWMImage(IconNode *icon, const IconSizeNode *size);
 static IconNode *LoadNamedIconHelper(const char *name, const char *path,
                                      char save, char preserveAspect);
 
 static ImageNode *GetBestImage(IconNode *icon, int rwidth, int rheight);
+static char IsBetterSize(int bestWidth, int bestHeight,
+                         int otherWidth, int otherHeight,
+                         int rwidth, int rheight);
 static ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
                                      int rwidth, int rheight);
 
@@ -95,8 +106,10 @@ void InitializeIcons(void)
    iconPaths = NULL;
    iconPathsTail = NULL;
    iconHash = Allocate(sizeof(IconNode*) * HASH_SIZE);
+   windowIconHash = Allocate(sizeof(IconNode*) * HASH_SIZE);
    for(x = 0; x < HASH_SIZE; x++) {
       iconHash[x] = NULL;
+      windowIconHash[x] = NULL;
    }
    memset(&emptyIcon, 0, sizeof(emptyIcon));
    iconSizeSet = 0;
@@ -128,7 +141,10 @@ void ShutdownIcons(void)
    unsigned int x;
    for(x = 0; x < HASH_SIZE; x++) {
       while(iconHash[x]) {
-         DoDestroyIcon(x, iconHash[x]);
+         DoDestroyIcon(&iconHash[x], iconHash[x]);
+      }
+      while(windowIconHash[x]) {
+         DoDestroyIcon(&windowIconHash[x], windowIconHash[x]);
       }
    }
    JXFreeGC(display, iconGC);
@@ -149,6 +165,10 @@ void DestroyIcons(void)
       Release(iconHash);
       iconHash = NULL;
    }
+   if(windowIconHash) {
+      Release(windowIconHash);
+      windowIconHash = NULL;
+   }
    if(defaultIconName) {
       Release(defaultIconName);
       defaultIconName = NULL;
@@ -250,9 +270,14 @@ void PutIcon(IconNode *icon, Drawable d, long fg,
 /** Load the icon for a client. */
 void LoadIcon(ClientNode *np)
 {
-   /* If client already has an icon, destroy it first. */
-   DestroyIcon(np->icon);
-   np->icon = NULL;
+   static unsigned iconSerial = 0;
+
+   /* If client already has an icon, destroy it first.
+    * The new icon may be allocated at the same address, so the serial
+    * number tells users of the icon that it changed. */
+   DestroyClientIcon(np);
+   iconSerial += 1;
+   np->iconSerial = iconSerial;
 
    /* Attempt to read _NET_WM_ICON for an icon. */
    np->icon = ReadNetWMIcon(np->window);
@@ -287,6 +312,25 @@ void LoadIcon(ClientNode *np)
    }
 }
 
+/** Release the icon for a client. */
+void DestroyClientIcon(ClientNode *np)
+{
+   IconNode *icon = np->icon;
+   np->icon = NULL;
+   if(icon && icon->windows) {
+      unsigned int x;
+      for(x = 0; x < icon->windowCount; x++) {
+         if(icon->windows[x] == np->window) {
+            ReleaseNetWMIcon(icon, np->window);
+            return;
+         }
+      }
+      ReleaseNetWMIcon(icon, np->owner);
+   } else {
+      DestroyIcon(icon);
+   }
+}
+
 /** Load an icon from a file. */
 IconNode *LoadNamedIcon(const char *name, char save, char preserveAspect)
 {
@@ -314,10 +358,10 @@ IconNode *LoadNamedIcon(const char *name, char save, char preserveAspect)
          icon = CreateIcon(image);
          icon->preserveAspect = preserveAspect;
          icon->name = CopyString(name);
+         icon->loaded = image;
          if(save) {
             InsertIcon(icon);
          }
-         DestroyImage(image);
          return icon;
       } else {
          return &emptyIcon;
@@ -336,6 +380,70 @@ IconNode *LoadNamedIcon(const char *name, char save, char preserveAspect)
    return NULL;
 }
 
+/** Start loading an icon in the background. */
+void PrefetchNamedIcon(const char *name)
+{
+#ifdef USE_PTHREAD
+   char *fileName;
+
+   if(!name || name[0] == 0 || FindIcon(name)) {
+      return;
+   }
+
+   fileName = FindIconFile(name);
+   if(fileName) {
+      PrefetchImage(fileName, 0, 0, 1);
+      Release(fileName);
+   }
+#endif
+}
+
+/** Find the file that would be used to load a named icon. */
+char *FindIconFile(const char *name)
+{
+   IconPathNode *ip;
+   char *temp;
+   unsigned nameLength;
+
+   if(!name || name[0] == 0) {
+      return NULL;
+   }
+
+   /* Check for an absolute file name. */
+   if(name[0] == '/') {
+      return CopyString(name);
+   }
+
+   /* Try icon paths. */
+   nameLength = strlen(name);
+   for(ip = iconPaths; ip; ip = ip->next) {
+      const unsigned pathLength = strlen(ip->path);
+      unsigned i;
+      temp = Allocate(nameLength + pathLength + MAX_EXTENSION_LENGTH + 1);
+      memcpy(&temp[0], ip->path, pathLength);
+      memcpy(&temp[pathLength], name, nameLength + 1);
+      for(i = 0; i < EXTENSION_COUNT; i++) {
+         const unsigned len = strlen(ICON_EXTENSIONS[i]);
+         memcpy(&temp[pathLength + nameLength], ICON_EXTENSIONS[i], len + 1);
+         if(access(temp, R_OK) == 0) {
+            return temp;
+         }
+      }
+      Release(temp);
+   }
+
+   return NULL;
+}
+
+/** Create an icon from an image. */
+IconNode *CreateIconFromImage(ImageNode *image, char preserveAspect)
+{
+   IconNode *icon = CreateIcon(image);
+   icon->images = image;
+   icon->preserveAspect = preserveAspect;
+   return icon;
+}
+
 /** Helper for loading icons by name. */
 IconNode *LoadNamedIconHelper(const char *name, const char *path,
                               char save, char preserveAspect)
@@ -389,37 +497,280 @@ IconNode *LoadNamedIconHelper(const char *name, const char *path,
       IconNode *result = CreateIcon(image);
       result->preserveAspect = preserveAspect;
       result->name = CopyString(temp);
+      result->loaded = image;
       if(save) {
          InsertIcon(result);
       }
-      DestroyImage(image);
       return result;
    }
 
    return NULL;
 }
 
-/** Read the icon property from a client. */
+/** Read the icon property from a client.
+ * Only the image sizes are read here, the image data is read from the
+ * window by GetBestImage once a particular size is needed.
+ */
 IconNode *ReadNetWMIcon(Window win)
 {
-   static const long MAX_LENGTH = 1 << 20;
+   static const unsigned long MAX_LENGTH = 1 << 20;
    IconNode *icon = NULL;
-   unsigned long count;
-   int status;
-   unsigned long extra;
-   Atom realType;
-   int realFormat;
-   unsigned char *data;
-   status = JXGetWindowProperty(display, win, atoms[ATOM_NET_WM_ICON],
-                                0, MAX_LENGTH, False, XA_CARDINAL,
-                                &realType, &realFormat, &count, &extra, &data);
-   if(status == Success && realFormat != 0 && data) {
-      icon = CreateIconFromBinary((unsigned long*)data, count);
+   IconSizeNode **tail = NULL;
+   unsigned long offset = 0;
+
+   while(offset < MAX_LENGTH) {
+
+      IconSizeNode *sp;
+      unsigned long count;
+      unsigned long extra;
+      unsigned long width, height;
+      Atom realType;
+      int realFormat;
+      unsigned char *data;
+      int status;
+
+      /* Read the width and height of the next image. */
+      status = JXGetWindowProperty(display, win, atoms[ATOM_NET_WM_ICON],
+                                   offset, 2, False, XA_CARDINAL,
+                                   &realType, &realFormat, &count,
+                                   &extra, &data);
+      if(status != Success || realFormat != 32 || !data) {
+         break;
+      }
+      if(count < 2) {
+         JXFree(data);
+         break;
+      }
+      width = ((unsigned long*)data)[0];
+      height = ((unsigned long*)data)[1];
       JXFree(data);
+
+      /* Note that "extra" is in bytes. */
+      extra /= 4;
+      if(JUNLIKELY(width == 0 || height == 0
+                   || width >= MAX_WINDOW_WIDTH
+                   || height >= MAX_WINDOW_HEIGHT
+                   || width * height > extra)) {
+         Debug("invalid image size: %lu x %lu + 2 > %lu",
+               width, height, extra + 2);
+         break;
+      }
+
+      if(icon == NULL) {
+         icon = Allocate(sizeof(IconNode));
+         memset(icon, 0, sizeof(IconNode));
+         icon->width = width;
+         icon->height = height;
+#ifdef USE_XRENDER
+         icon->render = haveRender;
+#endif
+         icon->preserveAspect = 1;
+         icon->transient = 1;
+         icon->windows = Allocate(sizeof(Window));
+         icon->windows[0] = win;
+         icon->windowCount = 1;
+         tail = &icon->sizes;
+      }
+      sp = Allocate(sizeof(IconSizeNode));
+      sp->offset = offset + 2;
+      sp->width = width;
+      sp->height = height;
+      sp->next = NULL;
+      *tail = sp;
+      tail = &sp->next;
+
+      offset += 2 + width * height;
+      if(extra == width * height) {
+         break;
+      }
+
+   }
+
+   if(icon) {
+      icon = InternNetWMIcon(icon, win);
    }
    return icon;
 }
 
+/** Share an icon read from _NET_WM_ICON with other windows.
+ * Windows with identical _NET_WM_ICON data share an icon. If a matching
+ * icon exists, the new icon is destroyed and the existing icon is
+ * returned. Icons whose data cannot be read are not shared.
+ */
+IconNode *InternNetWMIcon(IconNode *icon, Window win)
+{
+   IconSizeNode *sp;
+   IconNode *other;
+   unsigned long length;
+   unsigned int index;
+
+   for(sp = icon->sizes; sp->next; sp = sp->next);
+   length = sp->offset + sp->width * sp->height;
+   if(JUNLIKELY(!HashNetWMIcon(icon, win, length))) {
+      return icon;
+   }
+   index = icon->hash & (HASH_SIZE - 1);
+
+   /* Look for a matching icon. */
+   for(other = windowIconHash[index]; other; other = other->next) {
+      if(   other->hash == icon->hash && other->digest == icon->digest
+         && other->length == length) {
+         const unsigned int count = other->windowCount + 1;
+         DoDestroyIcon(NULL, icon);
+         other->windows = Reallocate(other->windows, sizeof(Window) * count);
+         other->windows[other->windowCount] = win;
+         other->windowCount = count;
+         return other;
+      }
+   }
+
+   /* No match, insert this icon. */
+   icon->interned = 1;
+   icon->prev = NULL;
+   icon->next = windowIconHash[index];
+   if(windowIconHash[index]) {
+      windowIconHash[index]->prev = icon;
+   }
+   windowIconHash[index] = icon;
+   return icon;
+}
+
+/** Compute the content hash of _NET_WM_ICON.
+ * Two independent 32-bit hashes (FNV-1a and the string hash) are
+ * computed over the whole property, which is read in chunks.
+ * Returns 0 if the data could not be read.
+ */
+char HashNetWMIcon(IconNode *icon, Window win, unsigned long length)
+{
+   unsigned long offset;
+   unsigned int hash = 0;
+   unsigned int digest = 2166136261U;
+
+   for(offset = 0; offset < length;) {
+      unsigned long count;
+      unsigned long extra;
+      unsigned long x;
+      Atom realType;
+      int realFormat;
+      unsigned char *data;
+      int status;
+
+      status = JXGetWindowProperty(display, win, atoms[ATOM_NET_WM_ICON],
+                                   offset,
+                                   Min(length - offset, NET_WM_ICON_CHUNK),
+                                   False, XA_CARDINAL,
+                                   &realType, &realFormat, &count,
+                                   &extra, &data);
+      if(status != Success || !data) {
+         return 0;
+      }
+      if(realFormat != 32 || count == 0) {
+         JXFree(data);
+         return 0;
+      }
+      for(x = 0; x < count; x++) {
+         const unsigned int value = (unsigned int)((unsigned long*)data)[x];
+         hash = (hash + (hash << 5)) ^ value;
+         digest = (digest ^ value) * 16777619U;
+      }
+      JXFree(data);
+      offset += count;
+   }
+
+   icon->hash = hash;
+   icon->digest = digest;
+   icon->length = length;
+   return 1;
+}
+
+/** Get the hash table list containing a window icon.
+ * Returns NULL if the icon is not shared.
+ */
+IconNode **GetNetWMIconBucket(const IconNode *icon)
+{
+   if(icon->interned) {
+      return &windowIconHash[icon->hash & (HASH_SIZE - 1)];
+   } else {
+      return NULL;
+   }
+}
+
+/** Release a window's reference to an icon read from _NET_WM_ICON. */
+void ReleaseNetWMIcon(IconNode *icon, Window win)
+{
+   unsigned int x;
+
+   Assert(icon->windowCount > 0);
+   for(x = 0; x < icon->windowCount; x++) {
+      if(icon->windows[x] == win) {
+         break;
+      }
+   }
+   Assert(x < icon->windowCount);
+   if(JUNLIKELY(x == icon->windowCount)) {
+      return;
+   }
+
+   icon->windowCount -= 1;
+   for(; x < icon->windowCount; x++) {
+      icon->windows[x] = icon->windows[x + 1];
+   }
+
+   if(icon->windowCount == 0) {
+      DoDestroyIcon(GetNetWMIconBucket(icon), icon);
+   }
+}
+
+/** Read an image from _NET_WM_ICON.
+ * The image is read from the first window sharing the icon that
+ * still has the data.
+ */
+ImageNode *ReadNetWMImage(IconNode *icon, const IconSizeNode *size)
+{
+   ImageNode *image = NULL;
+   const unsigned long length = size->width * size->height;
+   unsigned int i;
+
+   for(i = 0; i < icon->windowCount && !image; i++) {
+
+      unsigned long count;
+      unsigned long extra;
+      Atom realType;
+      int realFormat;
+      unsigned char *data;
+      int status;
+
+      status = JXGetWindowProperty(display, icon->windows[i],
+                                   atoms[ATOM_NET_WM_ICON],
+                                   size->offset, length, False, XA_CARDINAL,
+                                   &realType, &realFormat, &count,
+                                   &extra, &data);
+      if(status == Success && realFormat == 32 && data) {
+         if(JLIKELY(count == length)) {
+            const unsigned long *input = (const unsigned long*)data;
+            unsigned char *output;
+            unsigned long x;
+
+            image = CreateImage(size->width, size->height, 0);
+            output = image->data;
+
+            /* Note: the data types here might be of different sizes. */
+            for(x = 0; x < length; x++) {
+               *output++ = (input[x] >> 24) & 0xFF;
+               *output++ = (input[x] >> 16) & 0xFF;
+               *output++ = (input[x] >>  8) & 0xFF;
+               *output++ = (input[x] >>  0) & 0xFF;
+            }
+
+            image->next = icon->images;
+            icon->images = image;
+         }
+         JXFree(data);
+      }
+   }
+   return image;
+}
+
 /** Read the icon WMHint property from a client. */
 IconNode *ReadWMHintIcon(Window win)
 {
@@ -525,48 +876,88 @@ ImageNode *GetBestImage(IconNode *icon, int rwidth, int rheight)
    ImageNode *best;
    ImageNode *ip;
 
-   /* If we don't have an image loaded, load one. */
+   /* If the image data is in a window property, only read the size
+    * we need (if we don't already have it). */
+   if(icon->sizes) {
+      IconSizeNode *bestSize = icon->sizes;
+      IconSizeNode *sp;
+      for(sp = icon->sizes->next; sp; sp = sp->next) {
+         if(IsBetterSize(bestSize->width, bestSize->height,
+                         sp->width, sp->height, rwidth, rheight)) {
+            bestSize = sp;
+         }
+      }
+      for(ip = icon->images; ip; ip = ip->next) {
+         if(ip->width == bestSize->width && ip->height == bestSize->height) {
+            return ip;
+         }
+      }
+      return ReadNetWMImage(icon, bestSize);
+   }
+
+   /* If we don't have an image loaded, load one.
+    * The image read when the icon was loaded is used once if it is
+    * large enough, so the file isn't decoded twice. */
    if(icon->images == NULL) {
+      ImageNode *image = icon->loaded;
+      if(image) {
+         icon->loaded = NULL;
+         if(image->width >= rwidth && image->height >= rheight) {
+            return image;
+         }
+         DestroyImage(image);
+      }
       return LoadImage(icon->name, rwidth, rheight, icon->preserveAspect);
    }
 
-   /* Find the best image to use.
-    * Select the smallest image to completely cover the
-    * requested size.  If no image completely covers the
-    * requested size, select the one that overlaps the most area.
-    * If no size is specified, use the largest. */
+   /* Find the best image to use. */
    best = icon->images;
    for(ip = icon->images->next; ip; ip = ip->next) {
-      const int best_area = best->width * best->height;
-      const int other_area = ip->width * ip->height;
-      int best_overlap;
-      int other_overlap;
-      if(rwidth == 0 && rheight == 0) {
-         best_overlap = 0;
-         other_overlap = 0;
-      } else if(rwidth == 0) {
-         best_overlap = Min(best->height, rheight);
-         other_overlap = Min(ip->height, rheight);
-      } else if(rheight == 0) {
-         best_overlap = Min(best->width, rwidth);
-         other_overlap = Min(ip->width, rwidth);
-      } else {
-         best_overlap = Min(best->width, rwidth)
-                      * Min(best->height, rheight);
-         other_overlap = Min(ip->width, rwidth)
-                       * Min(ip->height, rheight);
-      }
-      if(other_overlap > best_overlap) {
+      if(IsBetterSize(best->width, best->height,
+                      ip->width, ip->height, rwidth, rheight)) {
          best = ip;
-      } else if(other_overlap == best_overlap) {
-         if(other_area < best_area) {
-            best = ip;
-         }
       }
    }
    return best;
 }
 
+/** Determine if an image size is a better match than the current best.
+ * Select the smallest image to completely cover the
+ * requested size.  If no image completely covers the
+ * requested size, select the one that overlaps the most area.
+ * If no size is specified, use the largest.
+ */
+char IsBetterSize(int bestWidth, int bestHeight,
+                  int otherWidth, int otherHeight,
+                  int rwidth, int rheight)
+{
+   const int best_area = bestWidth * bestHeight;
+   const int other_area = otherWidth * otherHeight;
+   int best_overlap;
+   int other_overlap;
+   if(rwidth == 0 && rheight == 0) {
+      best_overlap = 0;
+      other_overlap = 0;
+   } else if(rwidth == 0) {
+      best_overlap = Min(bestHeight, rheight);
+      other_overlap = Min(otherHeight, rheight);
+   } else if(rheight == 0) {
+      best_overlap = Min(bestWidth, rwidth);
+      other_overlap = Min(otherWidth, rwidth);
+   } else {
+      best_overlap = Min(bestWidth, rwidth) * Min(bestHeight, rheight);
+      other_overlap = Min(otherWidth, rwidth) * Min(otherHeight, rheight);
+   }
+   if(other_overlap > best_overlap) {
+      return 1;
+   } else if(other_overlap == best_overlap) {
+      if(other_area < best_area) {
+         return 1;
+      }
+   }
+   return 0;
+}
+
 /** Get a scaled icon. */
 ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
                               int rwidth, int rheight)
@@ -611,7 +1002,11 @@ ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
          /* If we are using xrender and only have one image size
           * available, we can simply scale the existing icon. */
          if(icon->render) {
-            if(icon->images == NULL || icon->images->next == NULL) {
+            if(icon->sizes) {
+               if(icon->sizes->next == NULL) {
+                  return np;
+               }
+            } else if(icon->images == NULL || icon->images->next == NULL) {
                return np;
             }
          }
@@ -631,6 +1026,16 @@ ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
    /* See if we can use XRender to create the icon. */
 #ifdef USE_XRENDER
    if(icon->render) {
+
+      /* Render icons are stored at the size of the image, so we may
+       * already have this one. */
+      for(np = icon->nodes; np; np = np->next) {
+         if(np->width == imageNode->width && np->height == imageNode->height
+            && (!icon->bitmap || np->fg == fg)) {
+            return np;
+         }
+      }
+
       np = CreateScaledRenderIcon(imageNode, fg);
       np->next = icon->nodes;
       icon->nodes = np;
@@ -660,9 +1065,7 @@ ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
    JXSetForeground(display, maskGC, 1);
 
    /* Create a temporary XImage for scaling. */
-   image = JXCreateImage(display, rootVisual, rootDepth,
-                         ZPixmap, 0, NULL, nwidth, nheight, 8, 0);
-   image->data = Allocate(sizeof(unsigned long) * nwidth * nheight);
+   image = CreateImageBuffer(rootDepth, nwidth, nheight);
 
    /* Determine the scale factor. */
    scalex = (imageNode->width << 16) / nwidth;
@@ -723,11 +1126,10 @@ ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
                               rootDepth);
 
    /* Render the image to the color data pixmap. */
-   JXPutImage(display, np->image, rootGC, image, 0, 0, 0, 0, nwidth, nheight);   
+   PutImageBuffer(np->image, rootGC, image, 0, 0, nwidth, nheight);
+
    /* Release the XImage. */
-   Release(image->data);
-   image->data = NULL;
-   JXDestroyImage(image);
+   DestroyImageBuffer(image);
 
    if(icon->images == NULL) {
       DestroyImage(imageNode);
@@ -737,59 +1139,6 @@ ScaledIconNode *GetScaledIcon(IconNode *icon, long fg,
 
 }
 
-/** Create an icon from binary data (as specified via window properties). */
-IconNode *CreateIconFromBinary(const unsigned long *input,
-                               unsigned int length)
-{
-   IconNode *result = NULL;
-   unsigned int offset = 0;
-
-   if(!input) {
-      return NULL;
-   }
-
-   while(offset < length) {
-
-      const unsigned width = input[offset + 0];
-      const unsigned height = input[offset + 1];
-      unsigned char *data;
-      ImageNode *image;
-      unsigned x;
-
-      if(JUNLIKELY(width * height + 2 > length - offset)) {
-         Debug("invalid image size: %d x %d + 2 > %d",
-               width, height, length - offset);
-         return result;
-      } else if(JUNLIKELY(width == 0 || height == 0)) {
-         Debug("invalid image size: %d x %d", width, height);
-         return result;
-      }
-
-      image = CreateImage(width, height, 0);
-      if(result == NULL) {
-         result = CreateIcon(image);
-      }
-      image->next = result->images;
-      result->images = image;
-      data = image->data;
-
-      /* Note: the data types here might be of different sizes. */
-      offset += 2;
-      for(x = 0; x < width * height; x++) {
-         *data++ = (input[offset] >> 24) & 0xFF;
-         *data++ = (input[offset] >> 16) & 0xFF;
-         *data++ = (input[offset] >>  8) & 0xFF;
-         *data++ = (input[offset] >>  0) & 0xFF;
-         offset += 1;
-      }
-
-      /* Don't insert this icon into the hash since it is transient. */
-
-   }
-
-   return result;
-}
-
 /** Create an empty icon node. */
 IconNode *CreateIcon(const ImageNode *image)
 {
@@ -798,6 +1147,13 @@ IconNode *CreateIcon(const ImageNode *image)
    icon->nodes = NULL;
    icon->name = NULL;
    icon->images = NULL;
+   icon->loaded = NULL;
+   icon->sizes = NULL;
+   icon->windows = NULL;
+   icon->windowCount = 0;
+   icon->hash = 0;
+   icon->digest = 0;
+   icon->length = 0;
    icon->next = NULL;
    icon->prev = NULL;
    icon->width = image->width;
@@ -808,11 +1164,15 @@ IconNode *CreateIcon(const ImageNode *image)
 #endif
    icon->preserveAspect = 1;
    icon->transient = 1;
+   icon->interned = 0;
    return icon;
 }
 
-/** Helper method for destroy icons. */
-void DoDestroyIcon(int index, IconNode *icon)
+/** Helper method for destroy icons.
+ * The bucket is the hash table list containing the icon (NULL if
+ * the icon is not in a hash table).
+ */
+void DoDestroyIcon(IconNode **bucket, IconNode *icon)
 {
    if(icon && icon != &emptyIcon) {
       while(icon->nodes) {
@@ -840,17 +1200,28 @@ void DoDestroyIcon(int index, IconNode *icon)
          Release(np);
       }
       DestroyImage(icon->images);
+      DestroyImage(icon->loaded);
+      while(icon->sizes) {
+         IconSizeNode *sp = icon->sizes->next;
+         Release(icon->sizes);
+         icon->sizes = sp;
+      }
+      if(icon->windows) {
+         Release(icon->windows);
+      }
       if(icon->name) {
          Release(icon->name);
       }
 
-      if(icon->prev) {
-         icon->prev->next = icon->next;
-      } else {
-         iconHash[index] = icon->next;
-      }
-      if(icon->next) {
-         icon->next->prev = icon->prev;
+      if(bucket) {
+         if(icon->prev) {
+            icon->prev->next = icon->next;
+         } else {
+            *bucket = icon->next;
+         }
+         if(icon->next) {
+            icon->next->prev = icon->prev;
+         }
       }
       Release(icon);
    }
@@ -860,8 +1231,12 @@ void DoDestroyIcon(int index, IconNode *icon)
 void DestroyIcon(IconNode *icon)
 {
    if(icon && icon->transient) {
-      const unsigned int index = GetHash(icon->name);
-      DoDestroyIcon(index, icon);
+      if(icon->windows) {
+         /* Release the icon for all windows sharing it. */
+         DoDestroyIcon(GetNetWMIconBucket(icon), icon);
+      } else {
+         DoDestroyIcon(NULL, icon);
+      }
    }
 }
 
@@ -26,12 +26,34 @@ typedef struct ScaledIconNode {
 
 } ScaledIconNode;
 
+/** Structure to hold the location of an image in _NET_WM_ICON.
+ * This allows images to be read from the window as they are needed.
+ */
+typedef struct IconSizeNode {
+
+   unsigned long offset;  /**< Offset of the image data (in longs). */
+   int width;             /**< Width of the image. */
+   int height;            /**< Height of the image. */
+
+   struct IconSizeNode *next;
+
+} IconSizeNode;
+
 /** Structure to hold an icon. */
 typedef struct IconNode {
 
    char *name;                    /**< The name of the icon. */
    struct ImageNode *images;      /**< Images associated with this icon. */
+   struct ImageNode *loaded;      /**< Image read when loading a named icon,
+                                   *   used for the first scaled icon. */
    struct ScaledIconNode *nodes;  /**< Scaled icons. */
+   struct IconSizeNode *sizes;    /**< Image sizes available from window. */
+   Window *windows;               /**< Windows sharing this icon. The image
+                                   *   data is read from the first. */
+   unsigned int windowCount;      /**< Number of windows sharing the icon. */
+   unsigned int hash;             /**< Content hash for window icons. */
+   unsigned int digest;           /**< Second content hash. */
+   unsigned long length;          /**< Length of the _NET_WM_ICON data. */
    int width;                     /**< Natural width. */
    int height;                    /**< Natural height. */
 
@@ -42,6 +64,7 @@ typedef struct IconNode {
                                    *   of the icon when scaling. */
    char bitmap;                   /**< Set if this is a bitmap. */
    char transient;                /**< Set if this icon is transient. */
+   char interned;                 /**< Set if in the window icon table. */
 #ifdef USE_XRENDER
    char render;                   /**< Set to use render. */
 #endif
@@ -84,6 +107,13 @@ void PutIcon(IconNode *icon, Drawable d,
  */
 void LoadIcon(struct ClientNode *np);
 
+/** Release the icon for a client.
+ * Icons read from _NET_WM_ICON are shared between windows with identical
+ * icons, so this releases the client's reference to the icon.
+ * @param np The client.
+ */
+void DestroyClientIcon(struct ClientNode *np);
+
 /** Load an icon.
  * @param name The name of the icon to load.
  * @param save Set if this icon should be saved in the icon hash.
@@ -92,6 +122,28 @@ void LoadIcon(struct ClientNode *np);
  */
 IconNode *LoadNamedIcon(const char *name, char save, char preserveAspect);
 
+/** Start loading an icon in the background.
+ * This allows icons to be decoded in parallel. A later call to
+ * LoadNamedIcon will use the image loaded in the background.
+ * @param name The name of the icon to load.
+ */
+void PrefetchNamedIcon(const char *name);
+
+/** Find the file that would be used to load a named icon.
+ * @param name The name of the icon.
+ * @return The file name (must be released) or NULL if not found.
+ */
+char *FindIconFile(const char *name);
+
+/** Create a transient icon from an image.
+ * This allows an image loaded at a particular size to be rendered
+ * without loading it again.
+ * @param image The image (owned by the icon after this call).
+ * @param preserveAspect Set to preserve the aspect ratio when scaling.
+ * @return The icon (must be released with DestroyIcon).
+ */
+IconNode *CreateIconFromImage(struct ImageNode *image, char preserveAspect);
+
 /** Load the default icon.
  * @return The default icon.
  */
@@ -116,8 +168,12 @@ void SetDefaultIcon(const char *name);
 #define AddIconPath( a )                   ICON_DUMMY_FUNCTION
 #define PutIcon( a, b, c, d, e, f, g )     ICON_DUMMY_FUNCTION
 #define LoadIcon( a )                      ICON_DUMMY_FUNCTION
+#define DestroyClientIcon( a )             ICON_DUMMY_FUNCTION
 #define GetDefaultIcon()                   NULL
 #define LoadNamedIcon( a, b, c )           NULL
+#define PrefetchNamedIcon( a )             ICON_DUMMY_FUNCTION
+#define FindIconFile( a )                  NULL
+#define CreateIconFromImage( a, b )        NULL
 #define DestroyIcon( a )                   ICON_DUMMY_FUNCTION
 #define SetDefaultIcon( a )                ICON_DUMMY_FUNCTION
 
@@ -26,6 +26,9 @@
 #  ifdef USE_RSVG
 #     include <librsvg/rsvg.h>
 #  endif
+#  ifdef USE_PTHREAD
+#     include <pthread.h>
+#  endif
 #endif /* MAKE_DEPEND */
 
 #include "image.h"
@@ -34,10 +37,29 @@
 #include "color.h"
 #include "misc.h"
 
+#include <fcntl.h>
+
+#ifndef O_CLOEXEC
+#  define O_CLOEXEC 0
+#endif
+
 typedef ImageNode *(*ImageLoader)(const char *fileName,
                                   int rwidth, int rheight,
                                   char preserveAspect);
 
+/** Loaders to use with DoLoadImage. */
+typedef unsigned char LoaderSetType;
+#define LOADERS_ALL           0  /**< Use all loaders. */
+#define LOADERS_REENTRANT     1  /**< Only use reentrant loaders. */
+#define LOADERS_NONREENTRANT  2  /**< Only use non-reentrant loaders. */
+
+static ImageNode *DoLoadImage(const char *fileName, int rwidth, int rheight,
+                              char preserveAspect, LoaderSetType loaders);
+static char UseLoader(unsigned index, LoaderSetType loaders);
+#if defined(USE_PNG) || defined(USE_JPEG)
+static FILE *OpenImageFile(const char *fileName);
+#endif
+
 #ifdef USE_CAIRO
 #ifdef USE_RSVG
 static ImageNode *LoadSVGImage(const char *fileName, int rwidth, int rheight,
@@ -62,6 +84,11 @@ static ImageNode *LoadXBMImage(const char *fileName, int rwidth, int rheight,
 #endif
 #ifdef USE_ICONS
 static ImageNode *CreateImageFromXImages(XImage *image, XImage *shape);
+static void ConvertTrueColorImage(XImage *image, ImageNode *result);
+static void ConvertPaletteImage(XImage *image, ImageNode *result);
+static void GetMaskShift(unsigned long mask, int *shift, int *bits);
+static unsigned char ScaleColorComponent(unsigned long value, int bits);
+static int ComparePixels(const void *a, const void *b);
 #endif
 
 #ifdef USE_XPM
@@ -71,36 +98,340 @@ static int FreeColors(Display *d, Colormap cmap, Pixel *pixels, int n,
                       void *closure);
 #endif
 
-/* File extension to image loader mapping. */
+/* File extension to image loader mapping.
+ * Loaders that don't use the X connection are reentrant and can be used
+ * from the image loading threads.
+ */
 static const struct {
    const char *extension;
    ImageLoader loader;
+   char reentrant;
 } IMAGE_LOADERS[] = {
 #ifdef USE_PNG
-   {".png",       LoadPNGImage      },
+   {".png",       LoadPNGImage,     1  },
 #endif
 #ifdef USE_JPEG
-   {".jpg",       LoadJPEGImage     },
-   {".jpeg",      LoadJPEGImage     },
+   {".jpg",       LoadJPEGImage,    1  },
+   {".jpeg",      LoadJPEGImage,    1  },
 #endif
 #ifdef USE_CAIRO
 #ifdef USE_RSVG
-   {".svg",       LoadSVGImage      },
+#if GLIB_CHECK_VERSION(2, 35, 0)
+   {".svg",       LoadSVGImage,     1  },
+#else
+   {".svg",       LoadSVGImage,     0  },
+#endif
 #endif
 #endif
 #ifdef USE_XPM
-   {".xpm",       LoadXPMImage      },
+   {".xpm",       LoadXPMImage,     0  },
 #endif
 #ifdef USE_XBM
-   {".xbm",       LoadXBMImage      },
+   {".xbm",       LoadXBMImage,     1  },
 #endif
 };
 static const unsigned IMAGE_LOADER_COUNT = ARRAY_LENGTH(IMAGE_LOADERS);
 
+#ifdef USE_PTHREAD
+
+/** Maximum number of image loading threads. */
+#define MAX_IMAGE_THREADS 8
+
+/** Maximum number of loaded images waiting to be used.
+ * Prefetched images that are never requested are discarded, oldest
+ * first, once there are more than this.
+ */
+#define MAX_DONE_JOBS 16
+
+/** States for a prefetched image. */
+typedef unsigned char ImageJobState;
+#define JOB_PENDING  0  /**< Waiting for a thread. */
+#define JOB_RUNNING  1  /**< Being loaded. */
+#define JOB_DONE     2  /**< Loaded (result may be NULL). */
+
+/** Image to be loaded in the background. */
+typedef struct ImageJob {
+   char *fileName;
+   int rwidth;
+   int rheight;
+   char preserveAspect;
+   ImageJobState state;
+   ImageNode *result;
+   struct ImageJob *next;
+} ImageJob;
+
+static pthread_mutex_t jobMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobReady = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t jobDone = PTHREAD_COND_INITIALIZER;
+static pthread_t imageThreads[MAX_IMAGE_THREADS];
+static unsigned int imageThreadCount = 0;
+static ImageJob *jobs = NULL;
+static ImageJob *jobsTail = NULL;
+static char stopThreads = 0;
+
+static void StartImageThreads(void);
+static void *ImageThread(void *arg);
+static ImageJob *FindImageJob(const char *fileName, int rwidth, int rheight,
+                              char preserveAspect, ImageJob **prev);
+static void RunImageJob(ImageJob *job);
+static void TrimImageJobs(void);
+
+/** Shutdown the image loading threads. */
+void ShutdownImages(void)
+{
+   unsigned int x;
+
+   pthread_mutex_lock(&jobMutex);
+   stopThreads = 1;
+   pthread_cond_broadcast(&jobReady);
+   pthread_mutex_unlock(&jobMutex);
+   for(x = 0; x < imageThreadCount; x++) {
+      pthread_join(imageThreads[x], NULL);
+   }
+   imageThreadCount = 0;
+   stopThreads = 0;
+
+   /* Discard any images that were never used. */
+   while(jobs) {
+      ImageJob *job = jobs->next;
+      DestroyImage(jobs->result);
+      Release(jobs->fileName);
+      Release(jobs);
+      jobs = job;
+   }
+   jobsTail = NULL;
+}
+
+/** Queue an image to be loaded in the background. */
+void PrefetchImage(const char *fileName, int rwidth, int rheight,
+                   char preserveAspect)
+{
+   ImageJob *job;
+
+   if(!fileName) {
+      return;
+   }
+
+   if(imageThreadCount == 0) {
+      StartImageThreads();
+   }
+
+   pthread_mutex_lock(&jobMutex);
+   if(!FindImageJob(fileName, rwidth, rheight, preserveAspect, NULL)) {
+      job = Allocate(sizeof(ImageJob));
+      job->fileName = CopyString(fileName);
+      job->rwidth = rwidth;
+      job->rheight = rheight;
+      job->preserveAspect = preserveAspect;
+      job->state = JOB_PENDING;
+      job->result = NULL;
+      job->next = NULL;
+      if(jobsTail) {
+         jobsTail->next = job;
+      } else {
+         jobs = job;
+      }
+      jobsTail = job;
+      pthread_cond_signal(&jobReady);
+      TrimImageJobs();
+   }
+   pthread_mutex_unlock(&jobMutex);
+}
+
+/** Discard the oldest loaded images that were not used.
+ * This must be called with the job mutex held.
+ */
+void TrimImageJobs(void)
+{
+   ImageJob **jp;
+   ImageJob *last = NULL;
+   unsigned int count = 0;
+
+   for(jp = &jobs; *jp; jp = &(*jp)->next) {
+      if((*jp)->state == JOB_DONE) {
+         count += 1;
+      }
+   }
+
+   jp = &jobs;
+   while(*jp && count > MAX_DONE_JOBS) {
+      ImageJob *job = *jp;
+      if(job->state == JOB_DONE) {
+         *jp = job->next;
+         DestroyImage(job->result);
+         Release(job->fileName);
+         Release(job);
+         count -= 1;
+      } else {
+         last = job;
+         jp = &job->next;
+      }
+   }
+   if(*jp == NULL) {
+      jobsTail = last;
+   }
+}
+
+/** Start the image loading threads. */
+void StartImageThreads(void)
+{
+   long count;
+   unsigned int x;
+
+   count = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+   count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+   count = Max(1, Min(MAX_IMAGE_THREADS, count));
+
+   for(x = 0; x < count; x++) {
+      if(pthread_create(&imageThreads[imageThreadCount], NULL,
+                        ImageThread, NULL) == 0) {
+         imageThreadCount += 1;
+      }
+   }
+}
+
+/** Image loading thread. */
+void *ImageThread(void *arg)
+{
+   pthread_mutex_lock(&jobMutex);
+   for(;;) {
+      ImageJob *job;
+      for(job = jobs; job; job = job->next) {
+         if(job->state == JOB_PENDING) {
+            break;
+         }
+      }
+      if(job) {
+         RunImageJob(job);
+      } else if(stopThreads) {
+         break;
+      } else {
+         pthread_cond_wait(&jobReady, &jobMutex);
+      }
+   }
+   pthread_mutex_unlock(&jobMutex);
+   return NULL;
+}
+
+/** Load a queued image.
+ * This must be called with the job mutex held. The mutex is released
+ * while the image is loading.
+ */
+void RunImageJob(ImageJob *job)
+{
+   ImageNode *result;
+   job->state = JOB_RUNNING;
+   pthread_mutex_unlock(&jobMutex);
+   result = DoLoadImage(job->fileName, job->rwidth, job->rheight,
+                        job->preserveAspect, LOADERS_REENTRANT);
+   pthread_mutex_lock(&jobMutex);
+   job->result = result;
+   job->state = JOB_DONE;
+   pthread_cond_broadcast(&jobDone);
+}
+
+/** Find a queued image.
+ * This must be called with the job mutex held.
+ */
+ImageJob *FindImageJob(const char *fileName, int rwidth, int rheight,
+                       char preserveAspect, ImageJob **prev)
+{
+   ImageJob *last = NULL;
+   ImageJob *job;
+   for(job = jobs; job; job = job->next) {
+      if(job->rwidth == rwidth && job->rheight == rheight
+         && job->preserveAspect == preserveAspect
+         && !strcmp(job->fileName, fileName)) {
+         break;
+      }
+      last = job;
+   }
+   if(prev) {
+      *prev = last;
+   }
+   return job;
+}
+
+#endif /* USE_PTHREAD */
+
 /** Load an image from the specified file. */
 ImageNode *LoadImage(const char *fileName, int rwidth, int rheight,
                      char preserveAspect)
 {
+
+#ifdef USE_PTHREAD
+
+   /* Check if this image was queued to be loaded in the background. */
+   if(jobs && fileName) {
+      ImageJob *prev;
+      ImageJob *job;
+      pthread_mutex_lock(&jobMutex);
+      job = FindImageJob(fileName, rwidth, rheight, preserveAspect, &prev);
+      if(job) {
+
+         /* Load it now if a thread hasn't started on it yet. */
+         if(job->state == JOB_PENDING) {
+            RunImageJob(job);
+         }
+         while(job->state != JOB_DONE) {
+            pthread_cond_wait(&jobDone, &jobMutex);
+         }
+
+         /* Remove the job from the queue. */
+         if(prev) {
+            prev->next = job->next;
+         } else {
+            jobs = job->next;
+         }
+         if(jobsTail == job) {
+            jobsTail = prev;
+         }
+
+      }
+      pthread_mutex_unlock(&jobMutex);
+
+      /* If the image couldn't be loaded, only the non-reentrant
+       * loaders remain to be tried. */
+      if(job) {
+         ImageNode *result = job->result;
+         Release(job->fileName);
+         Release(job);
+         if(result) {
+            return result;
+         }
+         return DoLoadImage(fileName, rwidth, rheight, preserveAspect,
+                            LOADERS_NONREENTRANT);
+      }
+   }
+
+#endif
+
+   return DoLoadImage(fileName, rwidth, rheight, preserveAspect, LOADERS_ALL);
+
+}
+
+/** Determine if a loader should be used. */
+char UseLoader(unsigned index, LoaderSetType loaders)
+{
+   switch(loaders) {
+   case LOADERS_REENTRANT:
+      return IMAGE_LOADERS[index].reentrant;
+   case LOADERS_NONREENTRANT:
+      return !IMAGE_LOADERS[index].reentrant;
+   default:
+      return 1;
+   }
+}
+
+/** Load an image from the specified file using the specified loaders.
+ * Only reentrant loaders (those that don't use the X connection) may be
+ * used from an image loading thread.
+ */
+ImageNode *DoLoadImage(const char *fileName, int rwidth, int rheight,
+                       char preserveAspect, LoaderSetType loaders)
+{
    unsigned i;
    unsigned name_length;
    ImageNode *result = NULL;
@@ -128,6 +459,9 @@ ImageNode *LoadImage(const char *fileName, int rwidth, int rheight,
          const unsigned offset = name_length - ext_length;
          if(!StrCmpNoCase(&fileName[offset], ext)) {
             const ImageLoader loader = IMAGE_LOADERS[i].loader;
+            if(!UseLoader(i, loaders)) {
+               break;
+            }
             result = (loader)(fileName, rwidth, rheight, preserveAspect);
             if(JLIKELY(result)) {
                return result;
@@ -140,6 +474,9 @@ ImageNode *LoadImage(const char *fileName, int rwidth, int rheight,
    /* We were unable to load by extension, so try everything. */
    for(i = 0; i < IMAGE_LOADER_COUNT; i++) {
       const ImageLoader loader = IMAGE_LOADERS[i].loader;
+      if(!UseLoader(i, loaders)) {
+         continue;
+      }
       result = (loader)(fileName, rwidth, rheight, preserveAspect);
       if(result) {
          /* We were able to load the image, so it must have either the
@@ -185,21 +522,41 @@ ImageNode *LoadImageFromDrawable(Drawable pmap, Pixmap mask)
 }
 #endif
 
+#if defined(USE_PNG) || defined(USE_JPEG)
+/** Open an image file for reading.
+ * Images are loaded on other threads while programs are started, so
+ * the file is opened close-on-exec to keep it out of the children.
+ */
+FILE *OpenImageFile(const char *fileName)
+{
+   FILE *fp;
+   const int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+   if(fd < 0) {
+      return NULL;
+   }
+   fp = fdopen(fd, "rb");
+   if(!fp) {
+      close(fd);
+   }
+   return fp;
+}
+#endif
+
 /** Load a PNG image from the given file name.
- * Since libpng uses longjmp, this function is not reentrant to simplify
- * the issues surrounding longjmp and local variables.
+ * Since libpng uses longjmp, variables that are modified after the
+ * setjmp are volatile.
  */
 #ifdef USE_PNG
 ImageNode *LoadPNGImage(const char *fileName, int rwidth, int rheight,
                         char preserveAspect)
 {
 
-   static ImageNode *result;
-   static FILE *fd;
-   static unsigned char **rows;
-   static png_structp pngData;
-   static png_infop pngInfo;
-   static png_infop pngEndInfo;
+   ImageNode * volatile result;
+   FILE *fd;
+   unsigned char ** volatile rows;
+   png_structp pngData;
+   png_infop pngInfo;
+   png_infop pngEndInfo;
 
    unsigned char header[8];
    unsigned long rowBytes;
@@ -217,7 +574,7 @@ ImageNode *LoadPNGImage(const char *fileName, int rwidth, int rheight,
    pngInfo = NULL;
    pngEndInfo = NULL;
 
-   fd = fopen(fileName, "rb");
+   fd = OpenImageFile(fileName);
    if(!fd) {
       return NULL;
    }
@@ -235,19 +592,6 @@ ImageNode *LoadPNGImage(const char *fileName, int rwidth, int rheight,
       return NULL;
    }
 
-   if(JUNLIKELY(setjmp(png_jmpbuf(pngData)))) {
-      png_destroy_read_struct(&pngData, &pngInfo, &pngEndInfo);
-      if(fd) {
-         fclose(fd);
-      }
-      if(rows) {
-         ReleaseStack(rows);
-      }
-      DestroyImage(result);
-      Warning(_("error reading PNG image: %s"), fileName);
-      return NULL;
-   }
-
    pngInfo = png_create_info_struct(pngData);
    if(JUNLIKELY(!pngInfo)) {
       png_destroy_read_struct(&pngData, NULL, NULL);
@@ -264,6 +608,19 @@ ImageNode *LoadPNGImage(const char *fileName, int rwidth, int rheight,
       return NULL;
    }
 
+   if(JUNLIKELY(setjmp(png_jmpbuf(pngData)))) {
+      png_destroy_read_struct(&pngData, &pngInfo, &pngEndInfo);
+      if(fd) {
+         fclose(fd);
+      }
+      if(rows) {
+         ReleaseStack(rows);
+      }
+      DestroyImage(result);
+      Warning(_("error reading PNG image: %s"), fileName);
+      return NULL;
+   }
+
    png_init_io(pngData, fd);
    png_set_sig_bytes(pngData, sizeof(header));
 
@@ -331,18 +688,18 @@ ImageNode *LoadJPEGImage(const char *fileName,
                          int rwidth, int rheight,
                          char preserveAspect)
 {
-   static ImageNode *result;
-   static struct jpeg_decompress_struct cinfo;
-   static FILE *fd;
-   static JSAMPARRAY buffer;
-   static JPEGErrorStruct jerr;
+   ImageNode * volatile result;
+   struct jpeg_decompress_struct cinfo;
+   FILE *fd;
+   JSAMPARRAY buffer;
+   JPEGErrorStruct jerr;
 
    int rowStride;
    int x;
    int inIndex, outIndex;
 
    /* Open the file. */
-   fd = fopen(fileName, "rb");
+   fd = OpenImageFile(fileName);
    if(fd == NULL) {
       return NULL;
    }
@@ -579,42 +936,186 @@ ImageNode *LoadXBMImage(const char *fileName, int rwidth, int rheight,
 
 /** Create an image from XImages giving color and shape information. */
 #ifdef USE_ICONS
-#define HASH_SIZE 16
 ImageNode *CreateImageFromXImages(XImage *image, XImage *shape)
 {
-   XColor colors[HASH_SIZE];
    ImageNode *result;
    unsigned char *dest;
    int x, y;
 
-   memset(colors, 0xFF, sizeof(colors));
    result = CreateImage(image->width, image->height, 0);
+
+   /* Convert the color data. */
+   if(image->depth == 1) {
+      dest = result->data;
+      for(y = 0; y < image->height; y++) {
+         for(x = 0; x < image->width; x++) {
+            const unsigned char value = XGetPixel(image, x, y) ? 0 : 255;
+            dest[1] = value;
+            dest[2] = value;
+            dest[3] = value;
+            dest += 4;
+         }
+      }
+   } else if(image->depth == rootDepth && rootVisual->class == TrueColor) {
+      ConvertTrueColorImage(image, result);
+   } else {
+      ConvertPaletteImage(image, result);
+   }
+
+   /* Apply the shape. */
    dest = result->data;
    for(y = 0; y < image->height; y++) {
       for(x = 0; x < image->width; x++) {
-         const unsigned long pixel = XGetPixel(image, x, y);
-         *dest++ = (!shape || XGetPixel(shape, x, y)) ? 255 : 0;
-         if(image->depth == 1) {
-            const unsigned char value = pixel ? 0 : 255;
-            *dest++ = value;
-            *dest++ = value;
-            *dest++ = value;
-         } else{
-            const unsigned index = pixel % HASH_SIZE;
-            if(colors[index].pixel != pixel) {
-               colors[index].pixel = pixel;
-               JXQueryColor(display, rootColormap, &colors[index]);
-            }
-            *dest++ = (unsigned char)(colors[index].red   >> 8);
-            *dest++ = (unsigned char)(colors[index].green >> 8);
-            *dest++ = (unsigned char)(colors[index].blue  >> 8);
-         }
+         *dest = (!shape || XGetPixel(shape, x, y)) ? 255 : 0;
+         dest += 4;
       }
    }
 
    return result;
 }
-#undef HASH_SIZE
+
+/** Get the shift and number of bits for a color mask. */
+void GetMaskShift(unsigned long mask, int *shift, int *bits)
+{
+   *shift = 0;
+   *bits = 0;
+   if(mask) {
+      while(!(mask & 1)) {
+         mask >>= 1;
+         *shift += 1;
+      }
+      while(mask & 1) {
+         mask >>= 1;
+         *bits += 1;
+      }
+   }
+}
+
+/** Scale a color component to 8 bits. */
+unsigned char ScaleColorComponent(unsigned long value, int bits)
+{
+   if(bits >= 8) {
+      return (unsigned char)(value >> (bits - 8));
+   } else if(bits > 0) {
+      return (unsigned char)((value * 255) / ((1UL << bits) - 1));
+   } else {
+      return 0;
+   }
+}
+
+/** Convert a TrueColor image.
+ * Colors are computed from the visual masks without asking the server.
+ * For the common pixel formats, pixels are read directly from the
+ * image data.
+ */
+void ConvertTrueColorImage(XImage *image, ImageNode *result)
+{
+   const int one = 1;
+   const int hostOrder = *(const char*)&one ? LSBFirst : MSBFirst;
+   const char direct = image->byte_order == hostOrder
+      && (image->bits_per_pixel == 32 || image->bits_per_pixel == 16);
+   unsigned char *dest = result->data;
+   int redShift, redBits;
+   int greenShift, greenBits;
+   int blueShift, blueBits;
+   int x, y;
+
+   GetMaskShift(rootVisual->red_mask, &redShift, &redBits);
+   GetMaskShift(rootVisual->green_mask, &greenShift, &greenBits);
+   GetMaskShift(rootVisual->blue_mask, &blueShift, &blueBits);
+
+   for(y = 0; y < image->height; y++) {
+      const char *line = &image->data[y * image->bytes_per_line];
+      for(x = 0; x < image->width; x++) {
+         unsigned long pixel;
+         if(!direct) {
+            pixel = XGetPixel(image, x, y);
+         } else if(image->bits_per_pixel == 32) {
+            pixel = ((const unsigned int*)line)[x];
+         } else {
+            pixel = ((const unsigned short*)line)[x];
+         }
+         dest[1] = ScaleColorComponent(
+            (pixel & rootVisual->red_mask) >> redShift, redBits);
+         dest[2] = ScaleColorComponent(
+            (pixel & rootVisual->green_mask) >> greenShift, greenBits);
+         dest[3] = ScaleColorComponent(
+            (pixel & rootVisual->blue_mask) >> blueShift, blueBits);
+         dest += 4;
+      }
+   }
+}
+
+/** Compare pixel values (for qsort and bsearch). */
+int ComparePixels(const void *a, const void *b)
+{
+   const unsigned long pa = ((const XColor*)a)->pixel;
+   const unsigned long pb = ((const XColor*)b)->pixel;
+   if(pa < pb) {
+      return -1;
+   } else if(pa > pb) {
+      return 1;
+   } else {
+      return 0;
+   }
+}
+
+/** Convert an image using a colormap.
+ * All distinct pixel values are looked up with as few XQueryColors
+ * requests as possible.
+ */
+void ConvertPaletteImage(XImage *image, ImageNode *result)
+{
+   const unsigned int MAX_QUERY = 1024;
+   const unsigned int size = image->width * image->height;
+   XColor *colors;
+   unsigned char *dest;
+   unsigned int count;
+   unsigned int i;
+   int x, y;
+
+   /* Get the distinct pixel values. */
+   colors = Allocate(sizeof(XColor) * size);
+   i = 0;
+   for(y = 0; y < image->height; y++) {
+      for(x = 0; x < image->width; x++) {
+         colors[i].pixel = XGetPixel(image, x, y);
+         i += 1;
+      }
+   }
+   qsort(colors, size, sizeof(XColor), ComparePixels);
+   count = 0;
+   for(i = 0; i < size; i++) {
+      if(count == 0 || colors[count - 1].pixel != colors[i].pixel) {
+         colors[count].pixel = colors[i].pixel;
+         count += 1;
+      }
+   }
+
+   /* Look up the colors. */
+   for(i = 0; i < count; i += MAX_QUERY) {
+      JXQueryColors(display, rootColormap, &colors[i],
+                    Min(MAX_QUERY, count - i));
+   }
+
+   /* Convert the image. */
+   dest = result->data;
+   for(y = 0; y < image->height; y++) {
+      for(x = 0; x < image->width; x++) {
+         XColor key;
+         const XColor *color;
+         key.pixel = XGetPixel(image, x, y);
+         color = bsearch(&key, colors, count, sizeof(XColor), ComparePixels);
+         Assert(color);
+         dest[1] = (unsigned char)(color->red   >> 8);
+         dest[2] = (unsigned char)(color->green >> 8);
+         dest[3] = (unsigned char)(color->blue  >> 8);
+         dest += 4;
+      }
+   }
+
+   Release(colors);
+}
 #endif /* USE_ICONS */
 
 ImageNode *CreateImage(unsigned width, unsigned height, char bitmap)
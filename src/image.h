@@ -24,6 +24,17 @@ typedef struct ImageNode {
 
 } ImageNode;
 
+/*@{*/
+#define InitializeImages() (void)(0)
+#define StartupImages()    (void)(0)
+#ifdef USE_PTHREAD
+void ShutdownImages(void);
+#else
+#define ShutdownImages()   (void)(0)
+#endif
+#define DestroyImages()    (void)(0)
+/*@}*/
+
 /** Load an image from a file.
  * @param fileName The file containing the image.
  * @param rwidth The preferred width.
@@ -34,6 +45,21 @@ typedef struct ImageNode {
 ImageNode *LoadImage(const char *fileName, int rwidth, int rheight,
                      char preserveAspect);
 
+/** Queue an image to be loaded in the background.
+ * A later call to LoadImage with the same arguments will return the
+ * image loaded in the background (waiting for it if necessary).
+ * @param fileName The file containing the image.
+ * @param rwidth The preferred width.
+ * @param rheight The preferred height.
+ * @param preserveAspect Set to preserve image aspect when scaling.
+ */
+#ifdef USE_PTHREAD
+void PrefetchImage(const char *fileName, int rwidth, int rheight,
+                   char preserveAspect);
+#else
+#define PrefetchImage( a, b, c, d ) (void)(0)
+#endif
+
 /** Load an image from a Drawable.
  * @param pmap The drawable.
  * @param mask The mask (may be None).
@@ -59,6 +59,9 @@
 #  ifdef HAVE_SYS_SELECT_H
 #     include <sys/select.h>
 #  endif
+#  ifdef HAVE_SPAWN_H
+#     include <spawn.h>
+#  endif
 
 #  include <X11/Xlib.h>
 #  ifdef HAVE_X11_XUTIL_H
@@ -84,6 +87,12 @@
 #     include <X11/extensions/shape.h>
 #  endif
 
+#  ifdef USE_SHM
+#     include <sys/ipc.h>
+#     include <sys/shm.h>
+#     include <X11/extensions/XShm.h>
+#  endif
+
 #  ifdef USE_XMU
 #     include <X11/Xmu/Xmu.h>
 #  endif
@@ -100,6 +109,10 @@
 #  ifdef USE_XRENDER
 #     include <X11/extensions/Xrender.h>
 #  endif
+#  ifdef USE_COMPOSITE
+#     include <X11/extensions/Xcomposite.h>
+#     include <X11/extensions/Xdamage.h>
+#  endif
 #  ifdef USE_FRIBIDI
 #     include <fribidi/fribidi.h>
 #  endif
@@ -413,4 +413,46 @@
 #define JXRenderComposite( a, b, c, d, e, f, g, h, i, j, k, l, m ) \
    JFUNC13(XRenderComposite, a, b, c, d, e, f, g, h, i, j, k, l, m)
 
+#define JXRenderSetPictureTransform( a, b, c ) \
+   JFUNC3(XRenderSetPictureTransform, a, b, c)
+
+#define JXRenderSetPictureFilter( a, b, c, d, e ) \
+   JFUNC5(XRenderSetPictureFilter, a, b, c, d, e)
+
+/* Xcomposite */
+
+#define JXCompositeQueryExtension( a, b, c ) \
+   JFUNC3(XCompositeQueryExtension, a, b, c)
+
+#define JXCompositeRedirectSubwindows( a, b, c ) \
+   JFUNC3(XCompositeRedirectSubwindows, a, b, c)
+
+#define JXCompositeUnredirectSubwindows( a, b, c ) \
+   JFUNC3(XCompositeUnredirectSubwindows, a, b, c)
+
+/* Xdamage */
+
+#define JXDamageQueryExtension( a, b, c ) \
+   JFUNC3(XDamageQueryExtension, a, b, c)
+
+#define JXDamageCreate( a, b, c ) JFUNC3(XDamageCreate, a, b, c)
+
+#define JXDamageDestroy( a, b ) JFUNC2(XDamageDestroy, a, b)
+
+#define JXDamageSubtract( a, b, c, d ) JFUNC4(XDamageSubtract, a, b, c, d)
+
+/* XShm */
+
+#define JXShmQueryExtension( a ) JFUNC1(XShmQueryExtension, a)
+
+#define JXShmCreateImage( a, b, c, d, e, f, g, h ) \
+   JFUNC8(XShmCreateImage, a, b, c, d, e, f, g, h)
+
+#define JXShmAttach( a, b ) JFUNC2(XShmAttach, a, b)
+
+#define JXShmDetach( a, b ) JFUNC2(XShmDetach, a, b)
+
+#define JXShmPutImage( a, b, c, d, e, f, g, h, i, j, k ) \
+   JFUNC11(XShmPutImage, a, b, c, d, e, f, g, h, i, j, k)
+
 #endif /* JXLIB_H */
@@ -16,6 +16,7 @@
 
 #include "border.h"
 #include "client.h"
+#include "clientlist.h"
 #include "color.h"
 #include "command.h"
 #include "cursor.h"
@@ -24,13 +25,17 @@
 #include "group.h"
 #include "binding.h"
 #include "icon.h"
+#include "image.h"
+#include "outline.h"
 #include "taskbar.h"
 #include "tray.h"
 #include "traybutton.h"
 #include "popup.h"
 #include "pager.h"
+#include "thumbnail.h"
 #include "swallow.h"
 #include "screen.h"
+#include "menu.h"
 #include "root.h"
 #include "desktop.h"
 #include "place.h"
@@ -39,10 +44,12 @@
 #include "misc.h"
 #include "background.h"
 #include "settings.h"
+#include "shm.h"
 #include "timing.h"
 #include "grab.h"
 
 #include <errno.h>
+#include <fcntl.h>
 
 Display *display = NULL;
 Window rootWindow;
@@ -76,6 +83,10 @@ int shapeEvent;
 #ifdef USE_XRENDER
 char haveRender;
 #endif
+#ifdef USE_COMPOSITE
+char haveComposite;
+int damageEvent;
+#endif
 
 static void Initialize(void);
 static void Startup(void);
@@ -97,6 +108,7 @@ static void SendReload(void);
 static void SendJWMMessage(const char *message);
 
 static char *displayString = NULL;
+static char *displayVariable = NULL;
 
 char *configPath = NULL;
 
@@ -296,6 +308,17 @@ void OpenConnection(void)
    colormapCount = MaxCmapsOfScreen(ScreenOfDisplay(display, rootScreen));
 
    XSetGraphicsExposures(display, rootGC, False);
+
+   /* Programs we start use this display, but should not inherit
+    * our connection to it. */
+   fcntl(ConnectionNumber(display), F_SETFD, FD_CLOEXEC);
+   if(!displayVariable) {
+      const char *name = DisplayString(display);
+      const size_t len = strlen(name) + 9;
+      displayVariable = malloc(len);
+      snprintf(displayVariable, len, "DISPLAY=%s", name);
+      putenv(displayVariable);
+   }
 }
 
 /** Predicate for XIfEvent to determine if we got the WM_Sn selection. */
@@ -320,6 +343,11 @@ void StartupConnection(void)
 #ifdef USE_XRENDER
    int renderEvent;
    int renderError;
+#endif
+#ifdef USE_COMPOSITE
+   int compositeEvent;
+   int compositeError;
+   int damageError;
 #endif
    struct sigaction sa;
    char name[32];
@@ -421,6 +449,17 @@ void StartupConnection(void)
    }
 #endif
 
+#ifdef USE_COMPOSITE
+   haveComposite = haveRender
+      && JXCompositeQueryExtension(display, &compositeEvent, &compositeError)
+      && JXDamageQueryExtension(display, &damageEvent, &damageError);
+   if(haveComposite) {
+      Debug("composite extension enabled");
+   } else {
+      Debug("composite extension disabled");
+   }
+#endif
+
    /* Make sure we have input focus. */
    win = None;
    JXGetInputFocus(display, &win, &revert);
@@ -468,6 +507,7 @@ void Initialize(void)
    InitializeBackgrounds();
    InitializeBindings();
    InitializeBorders();
+   InitializeClientList();
    InitializeClients();
    InitializeClock();
    InitializeColors();
@@ -482,12 +522,17 @@ void Initialize(void)
    InitializeGroups();
    InitializeHints();
    InitializeIcons();
+   InitializeImages();
+   InitializeOutline();
    InitializePager();
+   InitializeThumbnails();
    InitializePlacement();
    InitializePopup();
+   InitializeMenus();
    InitializeRootMenu();
    InitializeScreens();
    InitializeSettings();
+   InitializeShm();
    InitializeSwallow();
    InitializeTaskBar();
    InitializeTray();
@@ -512,11 +557,15 @@ void Startup(void)
    StartupGroups();
    StartupColors();
    StartupFonts();
+   StartupShm();
    StartupIcons();
+   StartupImages();
+   StartupOutline();
    StartupBackgrounds();
    StartupCursors();
 
    StartupPager();
+   StartupThumbnails();
    StartupClock();
    StartupTaskBar();
    StartupTrayButtons();
@@ -527,6 +576,7 @@ void Startup(void)
    StartupBindings();
    StartupBorders();
    StartupPlacement();
+   StartupClientList();
    StartupClients();
 
 #  ifndef DISABLE_CONFIRM
@@ -534,6 +584,7 @@ void Startup(void)
 #  endif
    StartupPopup();
 
+   StartupMenus();
    StartupRootMenu();
 
    SetDefaultCursor(rootWindow);
@@ -577,16 +628,22 @@ void Shutdown(void)
    ShutdownPopup();
    ShutdownBindings();
    ShutdownPager();
+   ShutdownMenus();
    ShutdownRootMenu();
    ShutdownDock();
    ShutdownTray();
    ShutdownTrayButtons();
    ShutdownTaskBar();
    ShutdownClock();
+   ShutdownOutline();
    ShutdownBorders();
    ShutdownClients();
+   ShutdownThumbnails();
+   ShutdownClientList();
    ShutdownBackgrounds();
+   ShutdownImages();
    ShutdownIcons();
+   ShutdownShm();
    ShutdownCursors();
    ShutdownFonts();
    ShutdownColors();
@@ -610,6 +667,7 @@ void Destroy(void)
 {
    DestroyBackgrounds();
    DestroyBorders();
+   DestroyClientList();
    DestroyClients();
    DestroyClock();
    DestroyColors();
@@ -624,13 +682,18 @@ void Destroy(void)
    DestroyGroups();
    DestroyHints();
    DestroyIcons();
+   DestroyImages();
+   DestroyOutline();
    DestroyBindings();
    DestroyPager();
+   DestroyThumbnails();
    DestroyPlacement();
    DestroyPopup();
+   DestroyMenus();
    DestroyRootMenu();
    DestroyScreens();
    DestroySettings();
+   DestroyShm();
    DestroySwallow();
    DestroyTaskBar();
    DestroyTray();
@@ -42,6 +42,10 @@ extern int shapeEvent;
 #ifdef USE_XRENDER
 extern char haveRender;
 #endif
+#ifdef USE_COMPOSITE
+extern char haveComposite;
+extern int damageEvent;
+#endif
 
 extern char *configPath;
 
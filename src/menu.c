@@ -25,6 +25,7 @@
 #include "hint.h"
 #include "misc.h"
 #include "popup.h"
+#include "command.h"
 
 #define BASE_ICON_OFFSET   3
 #define MENU_BORDER_SIZE   1
@@ -34,19 +35,46 @@ typedef unsigned char MenuSelectionType;
 #define MENU_LEAVE         1
 #define MENU_SUBSELECT     2
 
+/** Cached output of a dynamic menu command. */
+typedef struct DynamicMenuNode {
+   char *command;                /**< The command (including "exec:"). */
+   char *output;                 /**< The last valid output (or NULL). */
+   TimeType time;                /**< When the output was read. */
+   unsigned serial;              /**< Changes when the output changes. */
+   char pending;                 /**< Set while the command is running. */
+   struct DynamicMenuNode *next; /**< The next entry. */
+} DynamicMenuNode;
+
+static DynamicMenuNode *dynamicMenus = NULL;
+static unsigned dynamicSerial = 0;
+
+/** The innermost menu being shown (or NULL). */
+static Menu *shownMenu = NULL;
+
 static char ShowSubmenu(Menu *menu, Menu *parent,
                         RunMenuCommandType runner,
                         int x, int y, char keyboard);
 
+static void PrefetchSubmenuIcons(Menu *menu);
 static void PatchMenu(Menu *menu);
 static void UnpatchMenu(Menu *menu);
+static void PatchDynamicMenu(MenuItem *item, char hover);
+static DynamicMenuNode *FindDynamicMenu(const char *command);
+static void RunDynamicMenu(DynamicMenuNode *dp, unsigned timeout_ms,
+                           unsigned ttl_ms);
+static char UseDynamicMenuOutput(const DynamicMenuNode *dp,
+                                unsigned ttl_ms);
+static Menu *CreateDynamicMenu(DynamicMenuNode *dp, unsigned ttl_ms);
+static Menu *CreateMessageMenu(const char *message);
+static void HandleDynamicMenuOutput(char *output, void *data);
+static void RefreshDynamicMenu(Menu *menu, Menu *update);
 static void MapMenu(Menu *menu, int x, int y, char keyboard);
 static void HideMenu(Menu *menu);
 static void DrawMenu(Menu *menu);
+static void DrawMenuFrame(Menu *menu);
 
 static char MenuLoop(Menu *menu, RunMenuCommandType runner);
-static void MenuCallback(const TimeType *now, int x, int y,
-                         Window w, void *data);
+static const char *GetMenuPopup(void *object, int x, int y);
 static MenuSelectionType UpdateMotion(Menu *menu,
                                       RunMenuCommandType runner,
                                       XEvent *event);
@@ -54,9 +82,11 @@ static MenuSelectionType UpdateMotion(Menu *menu,
 static void UpdateMenu(Menu *menu);
 static void DrawMenuItem(Menu *menu, MenuItem *item, int index);
 static MenuItem *GetMenuItem(Menu *menu, int index);
+static IconNode *GetMenuItemIcon(const Menu *menu, MenuItem *item);
 static int GetNextMenuIndex(Menu *menu);
 static int GetPreviousMenuIndex(Menu *menu);
-static int GetMenuIndex(Menu *menu, int index);
+static int GetMenuIndex(Menu *menu, int y);
+static int FindMenuIndex(const Menu *menu, int y);
 static void SetPosition(Menu *tp, int index);
 static char IsMenuValid(const Menu *menu);
 
@@ -71,6 +101,10 @@ Menu *CreateMenu()
    menu->label = NULL;
    menu->dynamic = NULL;
    menu->timeout_ms = DEFAULT_TIMEOUT_MS;
+   menu->ttl_ms = 0;
+   menu->offsets = NULL;
+   menu->serial = 0;
+   menu->source = NULL;
    return menu;
 }
 
@@ -83,6 +117,34 @@ MenuItem *CreateMenuItem(MenuItemType type)
    return item;
 }
 
+/** Start loading icons for a menu in the background. */
+void PrefetchMenuIcons(Menu *menu)
+{
+   MenuItem *np;
+   for(np = menu->items; np; np = np->next) {
+      if(np->iconName && !np->icon && !np->iconPrefetched) {
+         /* Only look for the file once; it is found on the file
+          * system on the main thread. */
+         np->iconPrefetched = 1;
+         PrefetchNamedIcon(np->iconName);
+      }
+   }
+}
+
+/** Start loading icons for the submenus of a menu in the background.
+ * This is done when a menu is shown so the icons are likely to be
+ * ready by the time a submenu is opened.
+ */
+void PrefetchSubmenuIcons(Menu *menu)
+{
+   MenuItem *np;
+   for(np = menu->items; np; np = np->next) {
+      if(np->submenu) {
+         PrefetchMenuIcons(np->submenu);
+      }
+   }
+}
+
 /** Initialize a menu. */
 void InitializeMenu(Menu *menu)
 {
@@ -104,12 +166,13 @@ void InitializeMenu(Menu *menu)
    }
    menu->itemHeight = GetStringHeight(FONT_MENU);
    for(np = menu->items; np; np = np->next) {
+#ifdef USE_ICONS
+      /* Named icons are loaded when first drawn. */
       if(np->iconName) {
-         np->icon = LoadNamedIcon(np->iconName, 1, 1);
-         if(np->icon) {
-            hasIcon = 1;
-         }
-      } else if(np->icon) {
+         hasIcon = 1;
+      }
+#endif
+      if(np->icon) {
          hasIcon = 1;
       }
       menu->itemCount += 1;
@@ -162,7 +225,7 @@ void InitializeMenu(Menu *menu)
             menu->width = temp;
          }
       }
-      if(hasIcon && !np->icon) {
+      if(hasIcon && !np->icon && !np->iconName) {
          np->icon = &emptyIcon;
       }
       if(np->submenu) {
@@ -173,8 +236,6 @@ void InitializeMenu(Menu *menu)
    menu->width += hasSubmenu + menu->textOffset;
    menu->width += 7 + 2 * MENU_BORDER_SIZE;
    menu->height += MENU_BORDER_SIZE;
-   menu->mousex = -1;
-   menu->mousey = -1;
 
 }
 
@@ -210,9 +271,8 @@ char ShowMenu(Menu *menu, RunMenuCommandType runner,
       return 0;
    }
 
-   RegisterCallback(settings.popupDelay, MenuCallback, menu);
    ShowSubmenu(menu, NULL, runner, x, y, keyboard);
-   UnregisterCallback(MenuCallback, menu);
+   CancelPopupHover(menu);
    UnpatchMenu(menu);
 
    JXUngrabKeyboard(display, CurrentTime);
@@ -287,17 +347,23 @@ char ShowSubmenu(Menu *menu, Menu *parent,
                  int x, int y, char keyboard)
 {
 
+   Menu *previous;
    char status;
 
    PatchMenu(menu);
    menu->parent = parent;
    MapMenu(menu, x, y, keyboard);
+   PrefetchSubmenuIcons(menu);
 
+   previous = shownMenu;
+   shownMenu = menu;
    menuShown += 1;
    status = MenuLoop(menu, runner);
    menuShown -= 1;
+   shownMenu = previous;
 
    JXDestroyWindow(display, menu->window);
+   ForgetWindowProperties(menu->window);
    JXFreePixmap(display, menu->pixmap);
 
    return status;
@@ -324,14 +390,7 @@ void PatchMenu(Menu *menu)
          submenu = CreateWindowMenu(item->action.context);
          break;
       case MA_DYNAMIC:
-         if(!item->submenu) {
-            submenu = ParseDynamicMenu(
-               item->action.timeout_ms,
-               item->action.str);
-            if(JLIKELY(submenu)) {
-               submenu->itemHeight = item->action.value;
-            }
-         }
+         PatchDynamicMenu(item, 0);
          break;
       default:
          break;
@@ -343,6 +402,274 @@ void PatchMenu(Menu *menu)
    }
 }
 
+/** Create or refresh the submenu of a dynamic menu item.
+ * The command is run when the parent menu is shown. When the item is
+ * selected (hover is set), the command is only run again if the output
+ * is older than a non-zero ttl.
+ */
+void PatchDynamicMenu(MenuItem *item, char hover)
+{
+   DynamicMenuNode *dp = FindDynamicMenu(item->action.str);
+   Menu *submenu;
+
+   if(!dp) {
+      /* Menus read from files are parsed directly. */
+      if(item->submenu) {
+         return;
+      }
+      submenu = ParseDynamicMenu(item->action.timeout_ms,
+                                 item->action.str);
+   } else {
+      const unsigned ttl_ms = item->action.ttl_ms;
+      if(!hover || ttl_ms > 0) {
+         RunDynamicMenu(dp, item->action.timeout_ms, ttl_ms);
+      }
+      if(item->submenu) {
+         /* Placeholders have serial 0 and are kept while the
+          * command runs. */
+         if(UseDynamicMenuOutput(dp, ttl_ms)) {
+            if(item->submenu->serial == dp->serial) {
+               return;
+            }
+         } else if(dp->pending && item->submenu->serial == 0) {
+            return;
+         }
+      }
+      submenu = CreateDynamicMenu(dp, ttl_ms);
+   }
+
+   if(item->submenu) {
+      DestroyMenu(item->submenu);
+      item->submenu = NULL;
+   }
+   if(JLIKELY(submenu)) {
+      submenu->itemHeight = item->action.value;
+      InitializeMenu(submenu);
+      item->submenu = submenu;
+   }
+}
+
+/** Start regenerating a dynamic menu in the background. */
+void PrefetchDynamicMenu(const char *command, unsigned timeout_ms,
+                         unsigned ttl_ms)
+{
+   DynamicMenuNode *dp = FindDynamicMenu(command);
+   if(dp) {
+      RunDynamicMenu(dp, timeout_ms, ttl_ms);
+   }
+}
+
+/** Get a dynamic menu. */
+Menu *GetDynamicMenu(const char *command, unsigned timeout_ms,
+                     unsigned ttl_ms)
+{
+   DynamicMenuNode *dp = FindDynamicMenu(command);
+   if(!dp) {
+      return ParseDynamicMenu(timeout_ms, command);
+   }
+   RunDynamicMenu(dp, timeout_ms, ttl_ms);
+   return CreateDynamicMenu(dp, ttl_ms);
+}
+
+/** Find the cache entry for a dynamic menu.
+ * Returns NULL if the menu is not generated by a command.
+ */
+DynamicMenuNode *FindDynamicMenu(const char *command)
+{
+   DynamicMenuNode *dp;
+
+   if(strncmp(command, "exec:", 5)) {
+      return NULL;
+   }
+   for(dp = dynamicMenus; dp; dp = dp->next) {
+      if(!strcmp(dp->command, command)) {
+         return dp;
+      }
+   }
+
+   dp = Allocate(sizeof(DynamicMenuNode));
+   dp->command = CopyString(command);
+   dp->output = NULL;
+   dp->serial = 0;
+   dp->pending = 0;
+   dp->next = dynamicMenus;
+   dynamicMenus = dp;
+   return dp;
+}
+
+/** Run the command for a dynamic menu if its output is out of date. */
+void RunDynamicMenu(DynamicMenuNode *dp, unsigned timeout_ms,
+                    unsigned ttl_ms)
+{
+   TimeType now;
+   char *path;
+
+   if(dp->pending) {
+      return;
+   }
+   if(dp->output) {
+      GetCurrentTime(&now);
+      if(GetTimeDifference(&dp->time, &now) < ttl_ms) {
+         return;
+      }
+   }
+
+   path = CopyString(&dp->command[5]);
+   ExpandPath(&path);
+   dp->pending = 1;
+   ReadFromProcessAsync(path, timeout_ms, HandleDynamicMenuOutput, dp);
+   Release(path);
+}
+
+/** Determine if the cached output of a command should be shown.
+ * Out of date output is only shown while the command runs again if
+ * the menu has a non-zero ttl.
+ */
+char UseDynamicMenuOutput(const DynamicMenuNode *dp, unsigned ttl_ms)
+{
+   if(!dp->output) {
+      return 0;
+   }
+   return !dp->pending || ttl_ms > 0;
+}
+
+/** Create a menu from the cached output of a command.
+ * A placeholder is used while new output is being read.
+ */
+Menu *CreateDynamicMenu(DynamicMenuNode *dp, unsigned ttl_ms)
+{
+   Menu *menu = NULL;
+   if(UseDynamicMenuOutput(dp, ttl_ms)) {
+      menu = ParseMenuText(dp->output, &dp->command[5]);
+      if(JLIKELY(menu)) {
+         menu->serial = dp->serial;
+      }
+   } else if(dp->pending) {
+      menu = CreateMessageMenu(_("Loading..."));
+   }
+   if(menu) {
+      menu->source = dp;
+   }
+   return menu;
+}
+
+/** Create a placeholder menu containing a single message. */
+Menu *CreateMessageMenu(const char *message)
+{
+   Menu *menu = CreateMenu();
+   menu->items = CreateMenuItem(MENU_ITEM_NORMAL);
+   menu->items->name = CopyString(message);
+   menu->items->action.type = MA_NONE;
+   return menu;
+}
+
+/** Store the output of a dynamic menu command. */
+void HandleDynamicMenuOutput(char *output, void *data)
+{
+   DynamicMenuNode *dp = (DynamicMenuNode*)data;
+   Menu *menu;
+
+   dp->pending = 0;
+
+   /* Keep the previous output if the new output is not valid. */
+   menu = NULL;
+   if(JLIKELY(output)) {
+      menu = ParseMenuText(output, &dp->command[5]);
+      if(JUNLIKELY(!menu)) {
+         Release(output);
+      }
+   }
+   if(JLIKELY(menu)) {
+      if(dp->output) {
+         Release(dp->output);
+      }
+      dp->output = output;
+      dynamicSerial += 1;
+      dp->serial = dynamicSerial;
+      GetCurrentTime(&dp->time);
+      menu->serial = dp->serial;
+   } else if(dp->output) {
+      /* Fall back to the previous output. */
+      menu = ParseMenuText(dp->output, &dp->command[5]);
+      if(JLIKELY(menu)) {
+         menu->serial = dp->serial;
+      }
+   }
+   if(JUNLIKELY(!menu)) {
+      menu = CreateMessageMenu(_("(empty)"));
+   }
+
+   /* Update the menu if it is being shown.
+    * Only the innermost menu is updated since the others have
+    * submenus in use. Placeholders (serial 0) are always replaced. */
+   if(shownMenu && shownMenu->source == dp
+      && (shownMenu->serial == 0 || shownMenu->serial != menu->serial)) {
+      RefreshDynamicMenu(shownMenu, menu);
+   }
+   DestroyMenu(menu);
+}
+
+/** Replace the items of a menu that is being shown.
+ * The items of update are moved to menu.
+ */
+void RefreshDynamicMenu(Menu *menu, Menu *update)
+{
+   Menu *parent = menu->parent;
+   MenuItem *items;
+   MenuItem *ip;
+   char *label;
+   const int x = menu->x;
+   const int y = menu->y + menu->parentOffset;
+
+   items = menu->items;
+   menu->items = update->items;
+   update->items = items;
+   label = menu->label;
+   menu->label = update->label;
+   update->label = label;
+   menu->serial = update->serial;
+
+   /* Keep the item height from the configuration. */
+   menu->itemHeight = update->itemHeight;
+   if(parent) {
+      for(ip = parent->items; ip; ip = ip->next) {
+         if(ip->submenu == menu) {
+            menu->itemHeight = ip->action.value;
+            break;
+         }
+      }
+   }
+   if(menu->offsets) {
+      Release(menu->offsets);
+      menu->offsets = NULL;
+   }
+   InitializeMenu(menu);
+   menu->parent = parent;
+   PrefetchMenuIcons(menu);
+
+   JXDestroyWindow(display, menu->window);
+   ForgetWindowProperties(menu->window);
+   JXFreePixmap(display, menu->pixmap);
+   MapMenu(menu, x, y, 0);
+}
+
+/** Release the dynamic menu cache. */
+void ShutdownMenus(void)
+{
+   while(dynamicMenus) {
+      DynamicMenuNode *dp = dynamicMenus->next;
+      if(dynamicMenus->pending) {
+         CancelProcessRead(HandleDynamicMenuOutput, dynamicMenus);
+      }
+      if(dynamicMenus->output) {
+         Release(dynamicMenus->output);
+      }
+      Release(dynamicMenus->command);
+      Release(dynamicMenus);
+      dynamicMenus = dp;
+   }
+}
+
 /** Remove temporary items from a menu. */
 void UnpatchMenu(Menu *menu)
 {
@@ -449,13 +776,13 @@ char MenuLoop(Menu *menu, RunMenuCommandType runner)
                if(event.xbutton.x >= menu->x &&
                   event.xbutton.x < menu->x + menu->width &&
                   event.xbutton.y >= menu->y &&
-                  event.xbutton.y < menu->y + menu->height) {
+                  event.xbutton.y < menu->y + menu->windowHeight) {
                   break;
                } else if(parent &&
                          event.xbutton.x >= parent->x &&
                          event.xbutton.x < parent->x + parent->width &&
                          event.xbutton.y >= parent->y &&
-                         event.xbutton.y < parent->y + parent->height) {
+                         event.xbutton.y < parent->y + parent->windowHeight) {
                   break;
                }
             }
@@ -468,57 +795,40 @@ char MenuLoop(Menu *menu, RunMenuCommandType runner)
    }
 }
 
-/** Signal for showing popups. */
-void MenuCallback(const TimeType *now, int x, int y, Window w, void *data)
+/** Get the tooltip for the menu item under the mouse. */
+const char *GetMenuPopup(void *object, int x, int y)
 {
-   Menu *menu = data;
+   Menu *menu = object;
    MenuItem *item;
    int i;
 
-   /* Check if the mouse moved (and reset if it did). */
-   if(   abs(menu->mousex - x) > settings.doubleClickDelta
-      || abs(menu->mousey - y) > settings.doubleClickDelta) {
-      menu->mousex = x;
-      menu->mousey = y;
-      menu->lastTime = *now;
-      return;
-   }
-
-   /* See if enough time has passed. */
-   const unsigned long diff = GetTimeDifference(now, &menu->lastTime);
-   if(diff < settings.popupDelay) {
-      return;
-   }
-
    /* Locate the active menu item. */
    while(menu) {
       if(x > menu->x && x < menu->x + menu->width) {
-         if(y > menu->y && y < menu->y + menu->height) {
+         if(y > menu->y && y < menu->y + menu->windowHeight) {
             break;
          }
       }
       if(menu->currentIndex < 0) {
-         return;
+         return NULL;
       }
       item = menu->items;
       for(i = 0; i < menu->currentIndex; i++) {
          item = item->next;
       }
       if(item->type != MENU_ITEM_SUBMENU) {
-         return;
+         return NULL;
       }
       menu = item->submenu;
    }
-   if(menu->currentIndex < 0) {
-      return;
+   if(!menu || menu->currentIndex < 0) {
+      return NULL;
    }
    item = menu->items;
    for(i = 0; i < menu->currentIndex; i++) {
       item = item->next;
    }
-   if(item->tooltip) {
-      ShowPopup(x, y, item->tooltip, POPUP_MENU);
-   }
+   return item->tooltip;
 
 }
 
@@ -541,12 +851,17 @@ void MapMenu(Menu *menu, int x, int y, char keyboard)
          x = menu->screen->x + menu->screen->width - menu->width;
       }
    }
+
+   /* Menus taller than the screen are scrolled. */
+   menu->windowHeight = Min(menu->height, menu->screen->height);
+   menu->scroll = 0;
+
    temp = y;
-   if(y + menu->height > menu->screen->y + menu->screen->height) {
-      y = menu->screen->y + menu->screen->height - menu->height;
+   if(y + menu->windowHeight > menu->screen->y + menu->screen->height) {
+      y = menu->screen->y + menu->screen->height - menu->windowHeight;
    }
-   if(y < 0) {
-      y = 0;
+   if(y < menu->screen->y) {
+      y = menu->screen->y;
    }
 
    menu->x = x;
@@ -565,13 +880,13 @@ void MapMenu(Menu *menu, int x, int y, char keyboard)
    attr.save_under = True;
 
    menu->window = JXCreateWindow(display, rootWindow, x, y,
-                                 menu->width, menu->height, 0,
+                                 menu->width, menu->windowHeight, 0,
                                  CopyFromParent, InputOutput,
                                  CopyFromParent, attrMask, &attr);
    SetAtomAtom(menu->window, ATOM_NET_WM_WINDOW_TYPE,
                ATOM_NET_WM_WINDOW_TYPE_MENU);
    menu->pixmap = JXCreatePixmap(display, menu->window,
-                                 menu->width, menu->height, rootDepth);
+                                 menu->width, menu->windowHeight, rootDepth);
 
    if(settings.menuOpacity < UINT_MAX) {
       SetCardinalAtom(menu->window, ATOM_NET_WM_WINDOW_OPACITY,
@@ -592,47 +907,74 @@ void MapMenu(Menu *menu, int x, int y, char keyboard)
 
 }
 
-/** Draw a menu. */
+/** Draw a menu.
+ * Only the items in the visible part of the menu are drawn.
+ */
 void DrawMenu(Menu *menu)
 {
 
    MenuItem *np;
-   int x;
+   int index, last;
 
    JXSetForeground(display, rootGC, colors[COLOR_MENU_BG]);
    JXFillRectangle(display, menu->pixmap, rootGC, 0, 0,
-                   menu->width, menu->height);
+                   menu->width, menu->windowHeight);
+
+   if(menu->itemCount > 0) {
+      index = FindMenuIndex(menu, menu->scroll + menu->offsets[0]);
+      last = FindMenuIndex(menu, menu->scroll + menu->windowHeight);
+      np = GetMenuItem(menu, index);
+      for(; np && index <= last; np = np->next) {
+         DrawMenuItem(menu, np, index);
+         index += 1;
+      }
+   }
+   DrawMenuFrame(menu);
+
+   JXCopyArea(display, menu->pixmap, menu->window, rootGC,
+              0, 0, menu->width, menu->windowHeight, 0, 0);
+
+}
+
+/** Draw the border and label of a menu.
+ * This is drawn over any items that are partially scrolled out of view.
+ */
+void DrawMenuFrame(Menu *menu)
+{
+
+   const int height = menu->windowHeight;
+
+   if(menu->label) {
+      JXSetForeground(display, rootGC, colors[COLOR_MENU_BG]);
+      JXFillRectangle(display, menu->pixmap, rootGC, 0, 0,
+                      menu->width, menu->offsets[0]);
+      DrawMenuItem(menu, NULL, -1);
+   }
+   if(menu->scroll + height < menu->height) {
+      JXSetForeground(display, rootGC, colors[COLOR_MENU_BG]);
+      JXFillRectangle(display, menu->pixmap, rootGC,
+                      0, height - MENU_BORDER_SIZE,
+                      menu->width, MENU_BORDER_SIZE);
+   }
 
    if(settings.menuDecorations == DECO_MOTIF) {
       JXSetForeground(display, rootGC, colors[COLOR_MENU_UP]);
       JXDrawLine(display, menu->pixmap, rootGC,
                  0, 0, menu->width, 0);
       JXDrawLine(display, menu->pixmap, rootGC,
-                 0, 0, 0, menu->height);
+                 0, 0, 0, height);
 
       JXSetForeground(display, rootGC, colors[COLOR_MENU_DOWN]);
       JXDrawLine(display, menu->pixmap, rootGC,
-                 0, menu->height - 1, menu->width, menu->height - 1);
+                 0, height - 1, menu->width, height - 1);
       JXDrawLine(display, menu->pixmap, rootGC,
-                 menu->width - 1, 0, menu->width - 1, menu->height);
+                 menu->width - 1, 0, menu->width - 1, height);
    } else {
       JXSetForeground(display, rootGC, colors[COLOR_MENU_DOWN]);
       JXDrawRectangle(display, menu->pixmap, rootGC,
-                      0, 0, menu->width - 1, menu->height - 1);
+                      0, 0, menu->width - 1, height - 1);
    }
 
-   if(menu->label) {
-      DrawMenuItem(menu, NULL, -1);
-   }
-
-   x = 0;
-   for(np = menu->items; np; np = np->next) {
-      DrawMenuItem(menu, np, x);
-      ++x;
-   }
-   JXCopyArea(display, menu->pixmap, menu->window, rootGC,
-              0, 0, menu->width, menu->height, 0, 0);
-
 }
 
 /** Determine the action to take given an event. */
@@ -651,6 +993,11 @@ MenuSelectionType UpdateMotion(Menu *menu,
                        event->xmotion.window);
       DiscardMotionEvents(event, menu->window);
 
+      /* Tooltips are looked up starting from the top-level menu. */
+      for(tp = menu; tp->parent; tp = tp->parent);
+      HoverPopup(GetMenuPopup, tp, POPUP_MENU, None,
+                 event->xmotion.x_root, event->xmotion.y_root);
+
       x = event->xmotion.x_root - menu->x;
       y = event->xmotion.y_root - menu->y;
       subwindow = event->xmotion.subwindow;
@@ -733,7 +1080,7 @@ MenuSelectionType UpdateMotion(Menu *menu,
    }
 
    /* Update the selection on the current menu */
-   if(x > 0 && y > 0 && x < menu->width && y < menu->height) {
+   if(x > 0 && y > 0 && x < menu->width && y < menu->windowHeight) {
       menu->currentIndex = GetMenuIndex(menu, y);
    } else if(menu->parent && subwindow != menu->parent->window) {
 
@@ -760,23 +1107,25 @@ MenuSelectionType UpdateMotion(Menu *menu,
 
    }
 
-   /* Move the menu if needed. */
-   if(menu->height > menu->screen->height && menu->currentIndex >= 0) {
+   /* Scroll the menu if near the top or bottom. */
+   if(menu->height > menu->windowHeight && menu->currentIndex >= 0) {
 
-      /* If near the top, shift down. */
-      if(y + menu->y <= 0) {
-         if(menu->currentIndex > 0) {
-            menu->currentIndex -= 1;
-            SetPosition(menu, menu->currentIndex);
+      /* If near the top, scroll up. */
+      if(y < menu->offsets[0] + menu->itemHeight / 2 && menu->scroll > 0) {
+         const int index = GetPreviousMenuIndex(menu);
+         if(index < menu->currentIndex) {
+            menu->currentIndex = index;
+            SetPosition(menu, index);
          }
       }
 
-      /* If near the bottom, shift up. */
-      if(y + menu->y + menu->itemHeight / 2
-            >= menu->screen->y + menu->screen->height) {
-         if(menu->currentIndex + 1 < menu->itemCount) {
-            menu->currentIndex += 1;
-            SetPosition(menu, menu->currentIndex);
+      /* If near the bottom, scroll down. */
+      if(y >= menu->windowHeight - menu->itemHeight / 2
+         && menu->scroll + menu->windowHeight < menu->height) {
+         const int index = GetNextMenuIndex(menu);
+         if(index > menu->currentIndex) {
+            menu->currentIndex = index;
+            SetPosition(menu, index);
          }
       }
 
@@ -787,12 +1136,17 @@ MenuSelectionType UpdateMotion(Menu *menu,
       menu->lastIndex = menu->currentIndex;
    }
 
-   /* If the selected item is a submenu, show it. */
+   /* If the selected item is a submenu, show it.
+    * Dynamic menus are refreshed first in case new output arrived. */
    ip = GetMenuItem(menu, menu->currentIndex);
+   if(ip && (ip->action.type & MA_ACTION_MASK) == MA_DYNAMIC) {
+      PatchDynamicMenu(ip, 1);
+   }
    if(ip && IsMenuValid(ip->submenu)) {
       const int x = menu->x + menu->width
                   - (settings.menuDecorations == DECO_MOTIF ? 0 : 1);
-      const int y = menu->y + menu->offsets[menu->currentIndex] - 1;
+      const int y = menu->y + menu->offsets[menu->currentIndex]
+                  - menu->scroll - 1;
       if(ShowSubmenu(ip->submenu, menu, runner, x, y, 0)) {
 
          /* Item selected; destroy the menu tree. */
@@ -825,9 +1179,10 @@ void UpdateMenu(Menu *menu)
    if(ip != NULL) {
       DrawMenuItem(menu, ip, menu->currentIndex);
    }
+   DrawMenuFrame(menu);
 
    JXCopyArea(display, menu->pixmap, menu->window, rootGC,
-              0, 0, menu->width, menu->height, 0, 0);
+              0, 0, menu->width, menu->windowHeight, 0, 0);
 
 }
 
@@ -836,6 +1191,7 @@ void DrawMenuItem(Menu *menu, MenuItem *item, int index)
 {
 
    ButtonNode button;
+   int y;
 
    Assert(menu);
 
@@ -855,6 +1211,9 @@ void DrawMenuItem(Menu *menu, MenuItem *item, int index)
       return;
    }
 
+   /* Items are drawn relative to the visible part of the menu. */
+   y = menu->offsets[index] - menu->scroll;
+
    if(item->type != MENU_ITEM_SEPARATOR) {
       ColorType fg;
 
@@ -868,29 +1227,29 @@ void DrawMenuItem(Menu *menu, MenuItem *item, int index)
       }
 
       button.x = MENU_BORDER_SIZE;
-      button.y = menu->offsets[index];
+      button.y = y;
       button.font = FONT_MENU;
       button.width = menu->width - MENU_BORDER_SIZE * 2;
       button.height = menu->itemHeight;
       button.text = item->name;
-      button.icon = item->icon;
+      button.icon = GetMenuItemIcon(menu, item);
       DrawButton(&button);
 
       if(item->submenu) {
 
          const int asize = (menu->itemHeight + 7) / 8;
-         const int y = menu->offsets[index] + (menu->itemHeight + 1) / 2;
+         const int ay = y + (menu->itemHeight + 1) / 2;
          int x = menu->width - 2 * asize - 1;
          int i;
 
          JXSetForeground(display, rootGC, colors[fg]);
          for(i = 0; i < asize; i++) {
-            const int y1 = y - asize + i;
-            const int y2 = y + asize - i;
+            const int y1 = ay - asize + i;
+            const int y2 = ay + asize - i;
             JXDrawLine(display, menu->pixmap, rootGC, x, y1, x, y2);
             x += 1;
          }
-         JXDrawPoint(display, menu->pixmap, rootGC, x, y);
+         JXDrawPoint(display, menu->pixmap, rootGC, x, ay);
 
       }
 
@@ -898,22 +1257,40 @@ void DrawMenuItem(Menu *menu, MenuItem *item, int index)
       if(settings.menuDecorations == DECO_MOTIF) {
          JXSetForeground(display, rootGC, colors[COLOR_MENU_DOWN]);
          JXDrawLine(display, menu->pixmap, rootGC, 4,
-                    menu->offsets[index] + 2, menu->width - 6,
-                    menu->offsets[index] + 2);
+                    y + 2, menu->width - 6, y + 2);
          JXSetForeground(display, rootGC, colors[COLOR_MENU_UP]);
          JXDrawLine(display, menu->pixmap, rootGC, 4,
-                    menu->offsets[index] + 3, menu->width - 6,
-                    menu->offsets[index] + 3);
+                    y + 3, menu->width - 6, y + 3);
       } else {
          JXSetForeground(display, rootGC, colors[COLOR_MENU_FG]);
          JXDrawLine(display, menu->pixmap, rootGC, 4,
-                    menu->offsets[index] + 2, menu->width - 6,
-                    menu->offsets[index] + 2);
+                    y + 2, menu->width - 6, y + 2);
       }
    }
 
 }
 
+/** Get the icon for a menu item, loading it if needed.
+ * Icons are loaded the first time the item is drawn, so icons in
+ * submenus that are never opened are never loaded.
+ */
+IconNode *GetMenuItemIcon(const Menu *menu, MenuItem *item)
+{
+#ifdef USE_ICONS
+   /* No space is reserved for named icons without icon support. */
+   if(item->iconName && !item->icon) {
+      item->icon = LoadNamedIcon(item->iconName, 1, 1);
+      if(!item->icon) {
+         item->icon = &emptyIcon;
+      }
+   }
+#endif
+   if(!item->icon && menu->textOffset) {
+      return &emptyIcon;
+   }
+   return item->icon;
+}
+
 /** Get the next item in the menu. */
 int GetNextMenuIndex(Menu *menu)
 {
@@ -966,22 +1343,29 @@ int GetPreviousMenuIndex(Menu *menu)
    return menu->currentIndex;
 }
 
-/** Get the item in the menu given a y-coordinate. */
+/** Get the item in the menu given a y-coordinate in the menu window. */
 int GetMenuIndex(Menu *menu, int y)
 {
-
-   int x;
-
    if(y < menu->offsets[0]) {
       return -1;
    }
-   for(x = 0; x < menu->itemCount - 1; x++) {
-      if(y >= menu->offsets[x] && y < menu->offsets[x + 1]) {
-         return x;
+   return FindMenuIndex(menu, y + menu->scroll);
+}
+
+/** Find the item containing a y-offset from the top of all items. */
+int FindMenuIndex(const Menu *menu, int y)
+{
+   int low = 0;
+   int high = menu->itemCount - 1;
+   while(low < high) {
+      const int mid = (low + high + 1) / 2;
+      if(menu->offsets[mid] <= y) {
+         low = mid;
+      } else {
+         high = mid - 1;
       }
    }
-   return x;
-
+   return low;
 }
 
 /** Get the menu item associated with an index. */
@@ -1005,27 +1389,25 @@ MenuItem *GetMenuItem(Menu *menu, int index)
 
 }
 
-/** Set the active menu item. */
+/** Set the active menu item.
+ * The menu is scrolled if the item is not visible.
+ */
 void SetPosition(Menu *tp, int index)
 {
-   int y = tp->offsets[index] + tp->itemHeight / 2;
-   if(tp->height > tp->screen->height) {
-
-      int updated = 0;
-      while(y + tp->y < tp->itemHeight / 2) {
-         tp->y += tp->itemHeight;
-         updated = tp->itemHeight;
-      }
-      while(y + tp->y >= tp->screen->y + tp->screen->height) {
-         tp->y -= tp->itemHeight;
-         updated = -tp->itemHeight;
-      }
-      if(updated) {
-         JXMoveWindow(display, tp->window, tp->x, tp->y);
-         y += updated;
-      }
-
+   const int top = tp->offsets[0];
+   const int bottom = tp->windowHeight - MENU_BORDER_SIZE;
+   int y = tp->offsets[index] - tp->scroll;
+
+   if(y < top) {
+      tp->scroll -= top - y;
+      y = top;
+      DrawMenu(tp);
+   } else if(y + tp->itemHeight > bottom) {
+      tp->scroll += y + tp->itemHeight - bottom;
+      y = bottom - tp->itemHeight;
+      DrawMenu(tp);
    }
+   y += tp->itemHeight / 2;
 
    /* We need to do this twice so the event gets registered
     * on the submenu if one exists. */
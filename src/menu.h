@@ -14,6 +14,13 @@
 
 struct ScreenType;
 
+/*@{*/
+#define InitializeMenus()  (void)(0)
+#define StartupMenus()     (void)(0)
+void ShutdownMenus(void);
+#define DestroyMenus()     (void)(0)
+/*@}*/
+
 /** Enumeration of menu action types. */
 typedef unsigned char MenuActionType;
 #define MA_NONE               0
@@ -50,6 +57,7 @@ typedef struct MenuAction {
    char *str;
    unsigned value;
    unsigned timeout_ms;
+   unsigned ttl_ms;
 
    MenuActionType type;          /**< Type of action. */
 
@@ -73,8 +81,10 @@ typedef struct MenuItem {
    struct MenuItem *next;  /**< Next item in the menu. */
 
    /** An icon for this menu item.
-    * This field is handled by menu.c if iconName is set. */
+    * This field is handled by menu.c if iconName is set. The icon is
+    * loaded the first time the item is drawn. */
    struct IconNode *icon;  /**< Icon to display. */
+   char iconPrefetched;    /**< Set once the icon has been prefetched. */
 
 } MenuItem;
 
@@ -86,6 +96,7 @@ typedef struct Menu {
    char *label;            /**< Menu label (NULL for no label). */
    char *dynamic;          /**< Generating command of dynamic menu. */
    unsigned timeout_ms;    /**< Timeout in milliseconds for dynamic menus. */
+   unsigned ttl_ms;        /**< Cache lifetime of dynamic menus. */
    int itemHeight;         /**< User-specified menu item height. */
 
    /* These fields are handled by menu.c */
@@ -94,7 +105,9 @@ typedef struct Menu {
    int x;                  /**< The x-coordinate of the menu. */
    int y;                  /**< The y-coordinate of the menu. */
    int width;              /**< The width of the menu. */
-   int height;             /**< The height of the menu. */
+   int height;             /**< The height of all menu items. */
+   int windowHeight;       /**< The height of the menu window. */
+   int scroll;             /**< y-offset of the visible items. */
    int currentIndex;       /**< The current menu selection. */
    int lastIndex;          /**< The last menu selection. */
    unsigned int itemCount; /**< Number of menu items (excluding separators). */
@@ -102,9 +115,9 @@ typedef struct Menu {
    int textOffset;         /**< x-offset of text in the menu. */
    int *offsets;           /**< y-offsets of menu items. */
    struct Menu *parent;    /**< The parent menu (or NULL). */
+   unsigned serial;        /**< Output used to build a dynamic menu. */
+   struct DynamicMenuNode *source; /**< Cache entry of a dynamic menu. */
    const struct ScreenType *screen;
-   int mousex, mousey;
-   TimeType lastTime;
 
 } Menu;
 
@@ -116,6 +129,36 @@ Menu *CreateMenu();
 /** Create an empty menu item. */
 MenuItem *CreateMenuItem(MenuItemType type);
 
+/** Start loading the icons for the items of a menu in the background.
+ * Submenus are not included; their icons are prefetched when their
+ * parent menu is shown.
+ * @param menu The menu.
+ */
+void PrefetchMenuIcons(Menu *menu);
+
+/** Start regenerating a dynamic menu in the background.
+ * Nothing is done if the cached output is newer than ttl_ms or the
+ * command is already running. Only "exec:" menus are cached.
+ * @param command The command to generate the menu.
+ * @param timeout_ms The timeout in milliseconds.
+ * @param ttl_ms How long the output remains valid in milliseconds.
+ */
+void PrefetchDynamicMenu(const char *command, unsigned timeout_ms,
+                         unsigned ttl_ms);
+
+/** Get a dynamic menu.
+ * If the output of the command is out of date, a new copy is generated
+ * in the background. Until it arrives, the previous output is used if
+ * ttl_ms is non-zero and a placeholder menu is returned otherwise.
+ * The menu is rebuilt when the new output arrives if it is shown.
+ * @param command The command to generate the menu.
+ * @param timeout_ms The timeout in milliseconds.
+ * @param ttl_ms How long the output remains valid in milliseconds.
+ * @return The menu (NULL if the command failed).
+ */
+Menu *GetDynamicMenu(const char *command, unsigned timeout_ms,
+                     unsigned ttl_ms);
+
 /** Initialize a menu structure to be shown.
  * @param menu The menu to initialize.
  */
@@ -257,7 +257,6 @@ char MoveClient(ClientNode *np, int startx, int starty)
 
          if(doMove) {
             if(settings.moveMode == MOVE_OUTLINE) {
-               ClearOutline();
                height = north + south;
                if(!(np->state.status & STAT_SHADED)) {
                   height += np->height;
@@ -408,7 +407,6 @@ char MoveClientKeyboard(ClientNode *np)
       if(moved) {
 
          if(settings.moveMode == MOVE_OUTLINE) {
-            ClearOutline();
             DrawOutline(np->x - west, np->y - west,
                         np->width + west + east, height + north + west);
          } else {
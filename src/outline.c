@@ -10,39 +10,99 @@
 #include "jwm.h"
 #include "outline.h"
 #include "main.h"
-#include "grab.h"
+#include "color.h"
+#include "misc.h"
 
-static GC outlineGC = None;
-static int lastX, lastY;
-static int lastWidth, lastHeight;
+/** Width of the outline in pixels. */
+#define OUTLINE_WIDTH   2
+
+/** The outline is made of four thin override-redirect windows (top,
+ * bottom, left, and right) that are moved and resized as needed.
+ * This avoids grabbing the server and drawing on the root window.
+ */
+static Window outlineWindows[4];
+static char outlineMapped;
+
+static void CreateOutline(void);
+
+/** Initialize outline data. */
+void InitializeOutline(void)
+{
+   unsigned int x;
+   for(x = 0; x < ARRAY_LENGTH(outlineWindows); x++) {
+      outlineWindows[x] = None;
+   }
+   outlineMapped = 0;
+}
+
+/** Release outline windows. */
+void ShutdownOutline(void)
+{
+   unsigned int x;
+   for(x = 0; x < ARRAY_LENGTH(outlineWindows); x++) {
+      if(outlineWindows[x] != None) {
+         JXDestroyWindow(display, outlineWindows[x]);
+         outlineWindows[x] = None;
+      }
+   }
+   outlineMapped = 0;
+}
+
+/** Create the outline windows. */
+void CreateOutline(void)
+{
+   XSetWindowAttributes attr;
+   unsigned int x;
+
+   attr.override_redirect = True;
+   attr.background_pixel = colors[COLOR_TITLE_ACTIVE_BG1];
+   attr.save_under = True;
+   for(x = 0; x < ARRAY_LENGTH(outlineWindows); x++) {
+      outlineWindows[x] = JXCreateWindow(display, rootWindow,
+                                         0, 0, 1, 1, 0,
+                                         CopyFromParent, InputOutput,
+                                         CopyFromParent,
+                                         CWOverrideRedirect | CWBackPixel
+                                         | CWSaveUnder, &attr);
+   }
+}
 
 /** Draw an outline. */
 void DrawOutline(int x, int y, int width, int height)
 {
-   XGCValues gcValues;
-   gcValues.function = GXinvert;
-   gcValues.subwindow_mode = IncludeInferiors;
-   gcValues.line_width = 2;
-   outlineGC = JXCreateGC(display, rootWindow,
-                          GCFunction | GCSubwindowMode | GCLineWidth,
-                          &gcValues);
-   GrabServer();
-   JXDrawRectangle(display, rootWindow, outlineGC, x, y, width, height);
-   lastX = x;
-   lastY = y;
-   lastWidth = width;
-   lastHeight = height;
+   const int w = Max(width, OUTLINE_WIDTH);
+   const int h = Max(height, OUTLINE_WIDTH);
+   unsigned int i;
+
+   if(outlineWindows[0] == None) {
+      CreateOutline();
+   }
+
+   JXMoveResizeWindow(display, outlineWindows[0],
+                      x, y, w, OUTLINE_WIDTH);
+   JXMoveResizeWindow(display, outlineWindows[1],
+                      x, y + h - OUTLINE_WIDTH, w, OUTLINE_WIDTH);
+   JXMoveResizeWindow(display, outlineWindows[2],
+                      x, y, OUTLINE_WIDTH, h);
+   JXMoveResizeWindow(display, outlineWindows[3],
+                      x + w - OUTLINE_WIDTH, y, OUTLINE_WIDTH, h);
+
+   if(!outlineMapped) {
+      for(i = 0; i < ARRAY_LENGTH(outlineWindows); i++) {
+         JXMapRaised(display, outlineWindows[i]);
+      }
+      outlineMapped = 1;
+   }
 }
 
 /** Clear the last outline. */
 void ClearOutline(void)
 {
-   if(outlineGC != None) {
-      JXDrawRectangle(display, rootWindow, outlineGC,
-                      lastX, lastY, lastWidth, lastHeight);
-      UngrabServer();
-      JXFreeGC(display, outlineGC);
-      outlineGC = None;
+   unsigned int x;
+   if(outlineMapped) {
+      for(x = 0; x < ARRAY_LENGTH(outlineWindows); x++) {
+         JXUnmapWindow(display, outlineWindows[x]);
+      }
+      outlineMapped = 0;
    }
 }
-
@@ -20,7 +20,9 @@
 #include "timing.h"
 #include "popup.h"
 #include "font.h"
+#include "misc.h"
 #include "settings.h"
+#include "thumbnail.h"
 
 /** Structure to represent a pager tray component. */
 typedef struct PagerType {
@@ -32,11 +34,15 @@ typedef struct PagerType {
    int scalex;             /**< Horizontal scale factor (fixed point). */
    int scaley;             /**< Vertical scale factor (fixed point). */
    char labeled;           /**< Set to label the pager. */
+   char thumbnails;        /**< Set to show window thumbnails. */
 
    Pixmap buffer;          /**< Buffer for rendering the pager. */
 
-   TimeType mouseTime;     /**< Timestamp of last mouse movement. */
-   int mousex, mousey;     /**< Coordinates of last mouse location. */
+   /** Static parts of the pager (background, labels, and dividers). */
+   Pixmap background;
+
+   /** Desktop highlighted on the background (-1 if invalid). */
+   int backgroundDesktop;
 
    struct PagerType *next; /**< Next pager in the list. */
 
@@ -44,6 +50,17 @@ typedef struct PagerType {
 
 static PagerType *pagers = NULL;
 
+/** Desktops that need to be redrawn on every pager.
+ * Changes are found by comparing each client with the state saved in
+ * the client when it was last drawn. */
+static char *dirtyDesktops = NULL;
+
+/** Number of clients drawn on each desktop. */
+static int *desktopClientCounts = NULL;
+
+/** The current desktop when the pagers were last drawn. */
+static int lastDesktop = -1;
+
 static char shouldStopMove;
 
 static void Create(TrayComponentType *cp);
@@ -65,12 +82,21 @@ static void StopPagerMove(ClientNode *np,
 
 static void PagerMoveController(int wasDestroyed);
 
-static void DrawPager(const PagerType *pp);
+static void FindDirtyDesktops(void);
+
+static void DrawPager(PagerType *pp);
+
+static void DrawPagerBackground(const PagerType *pp, int desktop);
+
+static void DrawPagerDesktop(const PagerType *pp, int desktop);
 
-static void DrawPagerClient(const PagerType *pp, const ClientNode *np);
+static void DrawPagerClient(const PagerType *pp, ClientNode *np);
 
-static void SignalPager(const TimeType *now, int x, int y, Window w,
-                        void *data);
+static int GetPagerClientDesktop(const ClientNode *np);
+
+static ColorType GetPagerClientColor(const ClientNode *np);
+
+static const char *GetPagerPopup(void *object, int x, int y);
 
 
 /** Shutdown the pager. */
@@ -79,7 +105,15 @@ void ShutdownPager(void)
    PagerType *pp;
    for(pp = pagers; pp; pp = pp->next) {
       JXFreePixmap(display, pp->buffer);
+      JXFreePixmap(display, pp->background);
    }
+   if(dirtyDesktops) {
+      Release(dirtyDesktops);
+      Release(desktopClientCounts);
+      dirtyDesktops = NULL;
+      desktopClientCounts = NULL;
+   }
+   lastDesktop = -1;
 }
 
 /** Release pager data. */
@@ -87,7 +121,6 @@ void DestroyPager(void)
 {
    PagerType *pp;
    while(pagers) {
-      UnregisterCallback(SignalPager, pagers);
       pp = pagers->next;
       Release(pagers);
       pagers = pp;
@@ -95,7 +128,7 @@ void DestroyPager(void)
 }
 
 /** Create a new pager tray component. */
-TrayComponentType *CreatePager(char labeled)
+TrayComponentType *CreatePager(char labeled, char thumbnails)
 {
 
    TrayComponentType *cp;
@@ -105,11 +138,13 @@ TrayComponentType *CreatePager(char labeled)
    pp->next = pagers;
    pagers = pp;
    pp->labeled = labeled;
-   pp->mousex = -settings.doubleClickDelta;
-   pp->mousey = -settings.doubleClickDelta;
-   pp->mouseTime.seconds = 0;
-   pp->mouseTime.ms = 0;
+   pp->thumbnails = thumbnails;
+   if(thumbnails) {
+      RequestThumbnails();
+   }
    pp->buffer = None;
+   pp->background = None;
+   pp->backgroundDesktop = -1;
 
    cp = CreateTrayComponent();
    cp->object = pp;
@@ -119,8 +154,6 @@ TrayComponentType *CreatePager(char labeled)
    cp->ProcessButtonPress = ProcessPagerButtonEvent;
    cp->ProcessMotionEvent = ProcessPagerMotionEvent;
 
-   RegisterCallback(settings.popupDelay / 2, SignalPager, pp);
-
    return cp;
 }
 
@@ -142,6 +175,9 @@ void Create(TrayComponentType *cp)
    cp->pixmap = JXCreatePixmap(display, rootWindow, cp->width,
                                cp->height, rootDepth);
    pp->buffer = cp->pixmap;
+   pp->background = JXCreatePixmap(display, rootWindow, cp->width,
+                                   cp->height, rootDepth);
+   pp->backgroundDesktop = -1;
 
 }
 
@@ -177,17 +213,22 @@ void SetSize(TrayComponentType *cp, int width, int height)
       Assert(0);
    }
 
+   pp->scalex = ((pp->deskWidth - 2) << 16) / rootWidth;
+   pp->scaley = ((pp->deskHeight - 2) << 16) / rootHeight;
+
    if(pp->buffer != None) {
       JXFreePixmap(display, pp->buffer);
+      JXFreePixmap(display, pp->background);
       pp->buffer = JXCreatePixmap(display, rootWindow, cp->width,
                                   cp->height, rootDepth);
+      pp->background = JXCreatePixmap(display, rootWindow, cp->width,
+                                      cp->height, rootDepth);
+      pp->backgroundDesktop = -1;
       cp->pixmap = pp->buffer;
+      FindDirtyDesktops();
       DrawPager(pp);
    }
 
-   pp->scalex = ((pp->deskWidth - 2) << 16) / rootWidth;
-   pp->scaley = ((pp->deskHeight - 2) << 16) / rootHeight;
-
 }
 
 /** Get the desktop for a pager given a set of coordinates. */
@@ -246,10 +287,8 @@ void ProcessPagerMotionEvent(TrayComponentType *cp, int x, int y, int mask)
 {
 
    PagerType *pp = (PagerType*)cp->object;
-
-   pp->mousex = cp->screenx + x;
-   pp->mousey = cp->screeny + y;
-   GetCurrentTime(&pp->mouseTime);
+   HoverPopup(GetPagerPopup, pp, POPUP_PAGER, cp->tray->window,
+              cp->screenx + x, cp->screeny + y);
 }
 
 /** Start a pager move operation. */
@@ -497,153 +536,319 @@ void PagerMoveController(int wasDestroyed)
 
 }
 
-/** Draw a pager. */
-void DrawPager(const PagerType *pp)
+/** Find the desktops that need to be redrawn.
+ * Each client is compared with the state saved when it was last drawn.
+ * A desktop is dirty if a client on it changed, if a client moved to or
+ * from it, or if the number of clients on it changed (which catches
+ * clients that were removed).
+ */
+void FindDirtyDesktops(void)
 {
    ClientNode *np;
-   Pixmap buffer;
-   int width, height;
-   int deskWidth, deskHeight;
+   int *counts;
    unsigned int x;
-   const char *name;
-   int xc, yc;
-   int textWidth, textHeight;
-   int dx, dy;
-
-   buffer = pp->cp->pixmap;
-   width = pp->cp->width;
-   height = pp->cp->height;
-   deskWidth = pp->deskWidth;
-   deskHeight = pp->deskHeight;
-
-   /* Draw the background. */
-   JXSetForeground(display, rootGC, colors[COLOR_PAGER_BG]);
-   JXFillRectangle(display, buffer, rootGC, 0, 0, width, height);
-
-   /* Highlight the current desktop. */
-   JXSetForeground(display, rootGC, colors[COLOR_PAGER_ACTIVE_BG]);
-   dx = currentDesktop % settings.desktopWidth;
-   dy = currentDesktop / settings.desktopWidth;
-   JXFillRectangle(display, buffer, rootGC,
-                   dx * (deskWidth + 1), dy * (deskHeight + 1),
-                   deskWidth, deskHeight);
-
-   /* Draw the labels. */
+   int layer;
+
+   if(dirtyDesktops == NULL) {
+      dirtyDesktops = Allocate(settings.desktopCount);
+      desktopClientCounts = Allocate(settings.desktopCount * sizeof(int));
+      for(x = 0; x < settings.desktopCount; x++) {
+         dirtyDesktops[x] = 1;
+         desktopClientCounts[x] = 0;
+      }
+   }
+
+   /* The highlight and sticky clients follow the current desktop. */
+   if(lastDesktop != currentDesktop) {
+      if(lastDesktop >= 0) {
+         dirtyDesktops[lastDesktop] = 1;
+      }
+      dirtyDesktops[currentDesktop] = 1;
+      lastDesktop = currentDesktop;
+   }
+
+   counts = AllocateStack(settings.desktopCount * sizeof(int));
+   memset(counts, 0, settings.desktopCount * sizeof(int));
+   for(layer = FIRST_LAYER; layer <= LAST_LAYER; layer++) {
+      for(np = nodeTail[layer]; np; np = np->prev) {
+         const int desktop = GetPagerClientDesktop(np);
+         const int index = desktop >= 0 ? counts[desktop]++ : -1;
+         if(   desktop != np->pagerDesktop
+            || index != np->pagerIndex
+            || (desktop >= 0
+               && (  np->x != np->pagerX || np->y != np->pagerY
+                  || np->width != np->pagerWidth
+                  || np->height != np->pagerHeight
+                  || GetPagerClientColor(np) != np->pagerColor))) {
+            if(np->pagerDesktop >= 0) {
+               dirtyDesktops[np->pagerDesktop] = 1;
+            }
+            if(desktop >= 0) {
+               dirtyDesktops[desktop] = 1;
+            }
+            np->pagerDesktop = desktop;
+            np->pagerIndex = index;
+            np->pagerX = np->x;
+            np->pagerY = np->y;
+            np->pagerWidth = np->width;
+            np->pagerHeight = np->height;
+            np->pagerColor = GetPagerClientColor(np);
+         }
+      }
+   }
+
+   /* A changed count means a client was removed. */
+   for(x = 0; x < settings.desktopCount; x++) {
+      if(counts[x] != desktopClientCounts[x]) {
+         dirtyDesktops[x] = 1;
+         desktopClientCounts[x] = counts[x];
+      }
+   }
+   ReleaseStack(counts);
+
+}
+
+/** Draw the static parts of a desktop on a pager. */
+void DrawPagerBackground(const PagerType *pp, int desktop)
+{
+   const int deskWidth = pp->deskWidth;
+   const int deskHeight = pp->deskHeight;
+   const int dx = (desktop % settings.desktopWidth) * (deskWidth + 1);
+   const int dy = (desktop / settings.desktopWidth) * (deskHeight + 1);
+
+   /* Draw the background, highlighting the current desktop. */
+   if(desktop == currentDesktop) {
+      JXSetForeground(display, rootGC, colors[COLOR_PAGER_ACTIVE_BG]);
+   } else {
+      JXSetForeground(display, rootGC, colors[COLOR_PAGER_BG]);
+   }
+   JXFillRectangle(display, pp->background, rootGC,
+                   dx, dy, deskWidth, deskHeight);
+
+   /* Draw the label. */
    if(pp->labeled) {
-      textHeight = GetStringHeight(FONT_PAGER);
+      const int textHeight = GetStringHeight(FONT_PAGER);
       if(textHeight < deskHeight) {
-         for(x = 0; x < settings.desktopCount; x++) {
-            dx = x % settings.desktopWidth;
-            dy = x / settings.desktopWidth;
-            name = GetDesktopName(x);
-            textWidth = GetStringWidth(FONT_PAGER, name);
-            if(textWidth < deskWidth) {
-               xc = dx * (deskWidth + 1) + (deskWidth - textWidth) / 2;
-               yc = dy * (deskHeight + 1) + (deskHeight - textHeight) / 2;
-               RenderString(buffer, FONT_PAGER,
-                            COLOR_PAGER_TEXT, xc, yc, deskWidth, name);
-            }
+         const char *name = GetDesktopName(desktop);
+         const int textWidth = GetStringWidth(FONT_PAGER, name);
+         if(textWidth < deskWidth) {
+            const int xc = dx + (deskWidth - textWidth) / 2;
+            const int yc = dy + (deskHeight - textHeight) / 2;
+            RenderString(pp->background, FONT_PAGER,
+                         COLOR_PAGER_TEXT, xc, yc, deskWidth, name);
          }
       }
    }
+}
 
-   /* Draw the clients. */
-   for(x = FIRST_LAYER; x <= LAST_LAYER; x++) {
-      for(np = nodeTail[x]; np; np = np->prev) {
-         DrawPagerClient(pp, np);
+/** Draw a desktop and the clients on it. */
+void DrawPagerDesktop(const PagerType *pp, int desktop)
+{
+   ClientNode *np;
+   int layer;
+   const int x = (desktop % settings.desktopWidth) * (pp->deskWidth + 1);
+   const int y = (desktop / settings.desktopWidth) * (pp->deskHeight + 1);
+
+   JXCopyArea(display, pp->background, pp->buffer, rootGC,
+              x, y, pp->deskWidth, pp->deskHeight, x, y);
+   for(layer = FIRST_LAYER; layer <= LAST_LAYER; layer++) {
+      for(np = nodeTail[layer]; np; np = np->prev) {
+         if(np->pagerDesktop == desktop) {
+            DrawPagerClient(pp, np);
+         }
       }
    }
+}
 
-   /* Draw the desktop dividers. */
-   JXSetForeground(display, rootGC, colors[COLOR_PAGER_OUTLINE]);
-   for(x = 1; x < settings.desktopHeight; x++) {
-      JXDrawLine(display, buffer, rootGC,
-                 0, (deskHeight + 1) * x - 1,
-                 width, (deskHeight + 1) * x - 1);
+/** Draw a pager.
+ * Only desktops marked dirty are redrawn unless the pager has not been
+ * drawn before.
+ */
+void DrawPager(PagerType *pp)
+{
+   const int width = pp->cp->width;
+   const int height = pp->cp->height;
+   const int deskWidth = pp->deskWidth;
+   const int deskHeight = pp->deskHeight;
+   const char redrawAll = pp->backgroundDesktop < 0;
+   unsigned int x;
+   char drawn = 0;
+
+   /* Update the static layer. */
+   if(redrawAll) {
+      JXSetForeground(display, rootGC, colors[COLOR_PAGER_BG]);
+      JXFillRectangle(display, pp->background, rootGC, 0, 0, width, height);
+      for(x = 0; x < settings.desktopCount; x++) {
+         DrawPagerBackground(pp, x);
+      }
+      JXSetForeground(display, rootGC, colors[COLOR_PAGER_OUTLINE]);
+      for(x = 1; x < settings.desktopHeight; x++) {
+         JXDrawLine(display, pp->background, rootGC,
+                    0, (deskHeight + 1) * x - 1,
+                    width, (deskHeight + 1) * x - 1);
+      }
+      for(x = 1; x < settings.desktopWidth; x++) {
+         JXDrawLine(display, pp->background, rootGC,
+                    (deskWidth + 1) * x - 1, 0,
+                    (deskWidth + 1) * x - 1, height);
+      }
+      JXCopyArea(display, pp->background, pp->buffer, rootGC,
+                 0, 0, width, height, 0, 0);
+   } else if(pp->backgroundDesktop != currentDesktop) {
+      DrawPagerBackground(pp, pp->backgroundDesktop);
+      DrawPagerBackground(pp, currentDesktop);
+   }
+   pp->backgroundDesktop = currentDesktop;
+
+   /* Draw the desktops that changed. */
+   for(x = 0; x < settings.desktopCount; x++) {
+      if(redrawAll || dirtyDesktops[x]) {
+         DrawPagerDesktop(pp, x);
+         drawn = 1;
+      }
    }
-   for(x = 1; x < settings.desktopWidth; x++) {
-      JXDrawLine(display, buffer, rootGC,
-                 (deskWidth + 1) * x - 1, 0,
-                 (deskWidth + 1) * x - 1, height);
+
+   /* Client outlines may cover the dividers, so restore them. */
+   if(drawn) {
+      JXSetForeground(display, rootGC, colors[COLOR_PAGER_OUTLINE]);
+      for(x = 1; x < settings.desktopHeight; x++) {
+         JXDrawLine(display, pp->buffer, rootGC,
+                    0, (deskHeight + 1) * x - 1,
+                    width, (deskHeight + 1) * x - 1);
+      }
+      for(x = 1; x < settings.desktopWidth; x++) {
+         JXDrawLine(display, pp->buffer, rootGC,
+                    (deskWidth + 1) * x - 1, 0,
+                    (deskWidth + 1) * x - 1, height);
+      }
    }
 
 }
 
+/** Update the area of the pager containing a client. */
+void UpdatePagerClient(const ClientNode *np)
+{
+   if(dirtyDesktops && np->pagerDesktop >= 0) {
+      dirtyDesktops[np->pagerDesktop] = 1;
+   }
+   RequirePagerUpdate();
+}
+
 /** Update the pager. */
 void UpdatePager(void)
 {
 
    PagerType *pp;
+   unsigned int x;
 
    if(JUNLIKELY(shouldExit)) {
       return;
    }
+   if(pagers == NULL) {
+      return;
+   }
 
+   FindDirtyDesktops();
    for(pp = pagers; pp; pp = pp->next) {
+      const char redrawAll = pp->backgroundDesktop < 0;
 
       /* Draw the pager. */
       DrawPager(pp);
 
       /* Tell the tray to redraw. */
-      UpdateSpecificTray(pp->cp->tray, pp->cp);
+      if(redrawAll) {
+         UpdateSpecificTray(pp->cp->tray, pp->cp);
+      } else {
+         for(x = 0; x < settings.desktopCount; x++) {
+            if(dirtyDesktops[x]) {
+               const int dx = (x % settings.desktopWidth)
+                            * (pp->deskWidth + 1);
+               const int dy = (x / settings.desktopWidth)
+                            * (pp->deskHeight + 1);
+               const int width = Min(pp->deskWidth + 1, pp->cp->width - dx);
+               const int height = Min(pp->deskHeight + 1,
+                                      pp->cp->height - dy);
+               UpdateSpecificTrayArea(pp->cp->tray, pp->cp,
+                                      dx, dy, width, height);
+            }
+         }
+      }
 
    }
+   for(x = 0; x < settings.desktopCount; x++) {
+      dirtyDesktops[x] = 0;
+   }
 
 }
 
-/** Signal pagers (for popups). */
-void SignalPager(const TimeType *now, int x, int y, Window w, void *data)
+/** Get the popup text for a pager. */
+const char *GetPagerPopup(void *object, int x, int y)
 {
-   PagerType *pp = (PagerType*)data;
-   if(pp->cp->tray->window == w &&
-      abs(pp->mousex - x) < settings.doubleClickDelta &&
-      abs(pp->mousey - y) < settings.doubleClickDelta) {
-      if(GetTimeDifference(now, &pp->mouseTime) >= settings.popupDelay) {
-         const int desktop = GetPagerDesktop(pp, x - pp->cp->screenx,
-                                                 y - pp->cp->screeny);
-         if(desktop >= 0 && desktop < settings.desktopCount) {
-            const char *desktopName = GetDesktopName(desktop);
-            if(desktopName) {
-               ShowPopup(x, y, desktopName, POPUP_PAGER);
-            }
-         }
-
-      }
+   PagerType *pp = (PagerType*)object;
+   const int desktop = GetPagerDesktop(pp, x - pp->cp->screenx,
+                                           y - pp->cp->screeny);
+   if(desktop >= 0 && desktop < settings.desktopCount) {
+      return GetDesktopName(desktop);
    }
+   return NULL;
 }
 
-/** Draw a client on the pager. */
-void DrawPagerClient(const PagerType *pp, const ClientNode *np)
+/** Get the desktop a client is drawn on (-1 if not drawn). */
+int GetPagerClientDesktop(const ClientNode *np)
 {
-
-   int x, y;
-   int width, height;
-   int offx, offy;
-
-   /* Don't draw the client if it isn't mapped. */
    if(!(np->state.status & STAT_MAPPED)) {
-      return;
+      return -1;
    }
    if(np->state.status & STAT_NOPAGER) {
-      return;
+      return -1;
    }
-
-   /* Determine the desktop for the client. */
    if(np->state.status & STAT_STICKY) {
-      offx = currentDesktop % settings.desktopWidth;
-      offy = currentDesktop / settings.desktopWidth;
+      return currentDesktop;
+   }
+   return np->state.desktop;
+}
+
+/** Get the color used to fill a client on the pager. */
+ColorType GetPagerClientColor(const ClientNode *np)
+{
+   if((np->state.status & STAT_ACTIVE)
+      && (np->state.desktop == currentDesktop
+      || (np->state.status & STAT_STICKY))) {
+      return COLOR_PAGER_ACTIVE_FG;
+   } else if(np->state.status & STAT_FLASH) {
+      return COLOR_PAGER_ACTIVE_FG;
    } else {
-      offx = np->state.desktop % settings.desktopWidth;
-      offy = np->state.desktop / settings.desktopWidth;
+      return COLOR_PAGER_FG;
    }
+}
+
+/** Draw a client on the pager.
+ * This uses the client state saved by FindDirtyDesktops.
+ */
+void DrawPagerClient(const PagerType *pp, ClientNode *np)
+{
+
+   int x, y;
+   int width, height;
+   int fullWidth, fullHeight;
+   int srcx, srcy;
+   int offx, offy;
+
+   /* Determine the desktop for the client. */
+   offx = np->pagerDesktop % settings.desktopWidth;
+   offy = np->pagerDesktop / settings.desktopWidth;
    offx *= pp->deskWidth + 1;
    offy *= pp->deskHeight + 1;
 
    /* Determine the location and size of the client on the pager. */
-   x = 1 + ((np->x * pp->scalex) >> 16);
-   y = 1 + ((np->y * pp->scaley) >> 16);
-   width = (np->width * pp->scalex) >> 16;
-   height = (np->height * pp->scaley) >> 16;
+   x = 1 + ((np->pagerX * pp->scalex) >> 16);
+   y = 1 + ((np->pagerY * pp->scaley) >> 16);
+   width = (np->pagerWidth * pp->scalex) >> 16;
+   height = (np->pagerHeight * pp->scaley) >> 16;
+   fullWidth = width;
+   fullHeight = height;
+   srcx = x;
+   srcy = y;
 
    /* Normalize the size and offset. */
    if(x + width > pp->deskWidth) {
@@ -666,6 +871,10 @@ void DrawPagerClient(const PagerType *pp, const ClientNode *np)
       return;
    }
 
+   /* Offset into the thumbnail if the client was clipped. */
+   srcx = x - srcx;
+   srcy = y - srcy;
+
    /* Move to the correct desktop on the pager. */
    x += offx;
    y += offy;
@@ -676,17 +885,16 @@ void DrawPagerClient(const PagerType *pp, const ClientNode *np)
 
    /* Fill the client if there's room. */
    if(width > 1 && height > 1) {
-      ColorType fillColor;
-      if((np->state.status & STAT_ACTIVE)
-         && (np->state.desktop == currentDesktop
-         || (np->state.status & STAT_STICKY))) {
-         fillColor = COLOR_PAGER_ACTIVE_FG;
-      } else if(np->state.status & STAT_FLASH) {
-         fillColor = COLOR_PAGER_ACTIVE_FG;
-      } else {
-         fillColor = COLOR_PAGER_FG;
+      if(pp->thumbnails) {
+         const Pixmap thumbnail = GetThumbnail(np, fullWidth - 1,
+                                               fullHeight - 1);
+         if(thumbnail != None) {
+            JXCopyArea(display, thumbnail, pp->cp->pixmap, rootGC,
+                       srcx, srcy, width - 1, height - 1, x + 1, y + 1);
+            return;
+         }
       }
-      JXSetForeground(display, rootGC, colors[fillColor]);
+      JXSetForeground(display, rootGC, colors[np->pagerColor]);
       JXFillRectangle(display, pp->cp->pixmap, rootGC, x + 1, y + 1,
                       width - 1, height - 1);
    }
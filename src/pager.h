@@ -10,6 +10,7 @@
 #ifndef PAGER_H
 #define PAGER_H
 
+struct ClientNode;
 struct TrayComponentType;
 
 /*@{*/
@@ -21,12 +22,19 @@ void DestroyPager(void);
 
 /** Create a pager tray component.
  * @param labeled Set to label the pager.
+ * @param thumbnails Set to show window thumbnails.
  * @return A new pager tray component.
  */
-struct TrayComponentType *CreatePager(char labeled);
+struct TrayComponentType *CreatePager(char labeled, char thumbnails);
 
 /** Update pagers. */
 void UpdatePager(void);
 
+/** Update the area of the pagers showing a client.
+ * This is used when the contents of a client change.
+ * @param np The client.
+ */
+void UpdatePagerClient(const struct ClientNode *np);
+
 #endif /* PAGER_H */
 
@@ -39,6 +39,10 @@
 #include <fcntl.h>
 #include <errno.h>
 
+#ifndef O_CLOEXEC
+#  define O_CLOEXEC 0
+#endif
+
 /** Mapping of action names to values.
  * Note that this mapping must be sorted.
  */
@@ -154,6 +158,7 @@ static const char *HEIGHT_ATTRIBUTE = "height";
 static const char *DYNAMIC_ATTRIBUTE = "dynamic";
 static const char *SPACING_ATTRIBUTE = "spacing";
 static const char *TIMEOUT_ATTRIBUTE = "timeout";
+static const char *TTL_ATTRIBUTE = "ttl";
 static const char *POPUP_ATTRIBUTE = "popup";
 
 static const char *FALSE_VALUE = "false";
@@ -245,6 +250,7 @@ static int ParseAttribute(const StringMappingType *mapping, int count,
 static int ParseSigned(const TokenNode *tp, const char *str);
 static unsigned ParseUnsigned(const TokenNode *tp, const char *str);
 static unsigned ParseTimeout(const TokenNode *tp);
+static unsigned ParseTTL(const TokenNode *tp);
 static unsigned int ParseOpacity(const TokenNode *tp, const char *str);
 static WinLayerType ParseLayer(const TokenNode *tp, const char *str);
 static StatusWindowType ParseStatusWindowType(const TokenNode *tp);
@@ -451,8 +457,13 @@ void ParseFocusModel(const TokenNode *tp) {
       { "sloppy",       FOCUS_SLOPPY         },
       { "sloppytitle",  FOCUS_SLOPPY_TITLE   }
    };
+   const char *str;
    settings.focusModel = ParseTokenValue(mapping, ARRAY_LENGTH(mapping), tp,
                                          settings.focusModel);
+   str = FindAttribute(tp->attributes, "delay");
+   if(str) {
+      settings.focusDelay = ParseUnsigned(tp, str);
+   }
 }
 
 /** Parse snap mode for moving windows. */
@@ -558,6 +569,7 @@ void ParseRootMenu(const TokenNode *start)
    value = FindAttribute(start->attributes, DYNAMIC_ATTRIBUTE);
    menu->dynamic = CopyString(value);
    menu->timeout_ms = ParseTimeout(start);
+   menu->ttl_ms = ParseTTL(start);
 
    SetRootMenu(onroot, menu);
 }
@@ -603,6 +615,7 @@ MenuItem *ParseMenuItem(const TokenNode *start, Menu *menu, MenuItem *last)
          last->action.type = MA_DYNAMIC;
          last->action.str = CopyString(start->value);
          last->action.timeout_ms = ParseTimeout(start);
+         last->action.ttl_ms = ParseTTL(start);
 
          value = FindAttribute(start->attributes, HEIGHT_ATTRIBUTE);
          if(value) {
@@ -865,6 +878,20 @@ Menu *ParseDynamicMenu(unsigned timeout_ms, const char *command)
    return menu;
 }
 
+/** Parse a menu from the output of a dynamic menu command. */
+Menu *ParseMenuText(const char *text, const char *name)
+{
+   Menu *menu = NULL;
+   TokenNode *start = Tokenize(text, name);
+   if(JUNLIKELY(!start || start->type != TOK_JWM)) {
+      ParseError(NULL, _("invalid include: %s"), name);
+   } else {
+      menu = ParseMenu(start);
+   }
+   ReleaseTokens(start);
+   return menu;
+}
+
 /** Parse an action. */
 ActionType ParseAction(const char *str, const char **command)
 {
@@ -1284,7 +1311,9 @@ void ParseTray(const TokenNode *tp)
    if(attr) {
       delay = ParseUnsigned(tp, attr);
    }
-   SetAutoHideTray(tray, autohide, delay);
+   attr = FindAttribute(tp->attributes, "slide");
+   SetAutoHideTray(tray, autohide, delay,
+                   attr && !strcmp(attr, TRUE_VALUE));
 
    attr = FindAttribute(tp->attributes, X_ATTRIBUTE);
    if(attr) {
@@ -1358,6 +1387,7 @@ void ParsePager(const TokenNode *tp, TrayType *tray)
    TrayComponentType *cp;
    const char *temp;
    int labeled;
+   int thumbnails;
 
    Assert(tp);
    Assert(tray);
@@ -1367,7 +1397,16 @@ void ParsePager(const TokenNode *tp, TrayType *tray)
    if(temp && !strcmp(temp, TRUE_VALUE)) {
       labeled = 1;
    }
-   cp = CreatePager(labeled);
+   thumbnails = 0;
+   temp = FindAttribute(tp->attributes, "thumbnails");
+   if(temp && !strcmp(temp, TRUE_VALUE)) {
+      thumbnails = 1;
+   }
+   temp = FindAttribute(tp->attributes, "refresh");
+   if(temp) {
+      settings.thumbnailDelay = ParseUnsigned(tp, temp);
+   }
+   cp = CreatePager(labeled, thumbnails);
    AddTrayComponent(tray, cp);
 
 }
@@ -1998,7 +2037,7 @@ TokenNode *TokenizeFile(const char *fileName)
    path = CopyString(fileName);
    ExpandPath(&path);
 
-   int fd = open(path, O_RDONLY);
+   int fd = open(path, O_RDONLY | O_CLOEXEC);
    Release(path);
 
    if(fd < 0) {
@@ -2091,6 +2130,13 @@ unsigned ParseTimeout(const TokenNode *tp)
    return timeout_ms;
 }
 
+/** Parse a dynamic menu cache lifetime. */
+unsigned ParseTTL(const TokenNode *tp)
+{
+   char *temp = FindAttribute(tp->attributes, TTL_ATTRIBUTE);
+   return temp ? ParseUnsigned(tp, temp) : 0;
+}
+
 /** Parse opacity (a float between 0.0 and 1.0). */
 unsigned ParseOpacity(const TokenNode *tp, const char *str)
 {
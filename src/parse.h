@@ -24,5 +24,12 @@ void ParseConfig(const char *fileName);
  */
 struct Menu *ParseDynamicMenu(unsigned timeout_ms, const char *command);
 
+/** Parse a dynamic menu from the output of its command.
+ * @param text The output of the command.
+ * @param name The command (used for error messages).
+ * @return The menu (NULL if the output is invalid).
+ */
+struct Menu *ParseMenuText(const char *text, const char *name);
+
 #endif /* PARSE_H */
 
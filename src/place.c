@@ -420,7 +420,6 @@ int IntComparator(const void *a, const void *b)
 int TryTileClient(const BoundingBox *box, ClientNode *np, int x, int y)
 {
    const ClientNode *tp;
-   int layer;
    int north, south, east, west;
    int x1, x2, y1, y2;
    int ox1, ox2, oy1, oy2;
@@ -449,38 +448,37 @@ int TryTileClient(const BoundingBox *box, ClientNode *np, int x, int y)
        return INT_MAX;
    }
 
-   /* Loop over each client. */
-   for(layer = np->state.layer; layer < LAYER_COUNT; layer++) {
-      for(tp = nodes[layer]; tp; tp = tp->next) {
+   /* Loop over each client on the current desktop. */
+   for(tp = GetFirstVisibleClient(currentDesktop); tp;
+       tp = GetNextVisibleClient(tp)) {
 
-         /* Skip clients that aren't visible. */
-         if(!IsClientOnCurrentDesktop(tp)) {
-            continue;
-         }
-         if(!(tp->state.status & STAT_MAPPED)) {
-            continue;
-         }
-         if(tp == np) {
-            continue;
-         }
+      /* Skip clients that aren't visible. */
+      if(tp->state.layer < np->state.layer) {
+         continue;
+      }
+      if(!(tp->state.status & STAT_MAPPED)) {
+         continue;
+      }
+      if(tp == np) {
+         continue;
+      }
 
-         /* Get the boundaries of the other client. */
-         GetBorderSize(&tp->state, &north, &south, &east, &west);
-         ox1 = tp->x - west;
-         ox2 = tp->x + tp->width + east;
-         oy1 = tp->y - north;
-         oy2 = tp->y + tp->height + south;
+      /* Get the boundaries of the other client. */
+      GetBorderSize(&tp->state, &north, &south, &east, &west);
+      ox1 = tp->x - west;
+      ox2 = tp->x + tp->width + east;
+      oy1 = tp->y - north;
+      oy2 = tp->y + tp->height + south;
 
-         /* Check for an overlap. */
-         if(x2 <= ox1 || x1 >= ox2) {
-            continue;
-         }
-         if(y2 <= oy1 || y1 >= oy2) {
-            continue;
-         }
-         overlap += (Min(ox2, x2) - Max(ox1, x1))
-                  * (Min(oy2, y2) - Max(oy1, y1));
+      /* Check for an overlap. */
+      if(x2 <= ox1 || x1 >= ox2) {
+         continue;
       }
+      if(y2 <= oy1 || y1 >= oy2) {
+         continue;
+      }
+      overlap += (Min(ox2, x2) - Max(ox1, x1))
+               * (Min(oy2, y2) - Max(oy1, y1));
    }
 
    return overlap;
@@ -491,7 +489,6 @@ char TileClient(const BoundingBox *box, ClientNode *np)
 {
 
    const ClientNode *tp;
-   int layer;
    int north, south, east, west;
    int i, j;
    int count;
@@ -502,19 +499,18 @@ char TileClient(const BoundingBox *box, ClientNode *np)
 
    /* Count insertion points, including bounding box edges. */
    count = 2;
-   for(layer = np->state.layer; layer < LAYER_COUNT; layer++) {
-      for(tp = nodes[layer]; tp; tp = tp->next) {
-         if(!IsClientOnCurrentDesktop(tp)) {
-            continue;
-         }
-         if(!(tp->state.status & STAT_MAPPED)) {
-            continue;
-         }
-         if(tp == np) {
-            continue;
-         }
-         count += 2;
+   for(tp = GetFirstVisibleClient(currentDesktop); tp;
+       tp = GetNextVisibleClient(tp)) {
+      if(tp->state.layer < np->state.layer) {
+         continue;
+      }
+      if(!(tp->state.status & STAT_MAPPED)) {
+         continue;
+      }
+      if(tp == np) {
+         continue;
       }
+      count += 2;
    }
 
    /* Allocate space for the points. */
@@ -525,24 +521,23 @@ char TileClient(const BoundingBox *box, ClientNode *np)
    xs[0] = box->x;
    ys[0] = box->y;
    count = 1;
-   for(layer = np->state.layer; layer < LAYER_COUNT; layer++) {
-      for(tp = nodes[layer]; tp; tp = tp->next) {
-         if(!IsClientOnCurrentDesktop(tp)) {
-            continue;
-         }
-         if(!(tp->state.status & STAT_MAPPED)) {
-            continue;
-         }
-         if(tp == np) {
-            continue;
-         }
-         GetBorderSize(&tp->state, &north, &south, &east, &west);
-         xs[count + 0] = tp->x - west;
-         xs[count + 1] = tp->x + tp->width + east;
-         ys[count + 0] = tp->y - north;
-         ys[count + 1] = tp->y + tp->height + south;
-         count += 2;
+   for(tp = GetFirstVisibleClient(currentDesktop); tp;
+       tp = GetNextVisibleClient(tp)) {
+      if(tp->state.layer < np->state.layer) {
+         continue;
+      }
+      if(!(tp->state.status & STAT_MAPPED)) {
+         continue;
+      }
+      if(tp == np) {
+         continue;
       }
+      GetBorderSize(&tp->state, &north, &south, &east, &west);
+      xs[count + 0] = tp->x - west;
+      xs[count + 1] = tp->x + tp->width + east;
+      ys[count + 0] = tp->y - north;
+      ys[count + 1] = tp->y + tp->height + south;
+      count += 2;
    }
 
    /* Try placing at lower right edge of box, too. */
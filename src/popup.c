@@ -30,11 +30,25 @@ typedef struct PopupType {
    int lineCount; /* The number of lines. */
    Window window;
    Pixmap pmap;
+   int pmapWidth, pmapHeight;
+   char mapped;
 } PopupType;
 
+/** The object the mouse is over (see HoverPopup). */
+typedef struct PopupHoverType {
+   PopupTextCallback callback;
+   void *object;
+   PopupMaskType context;
+   Window window;
+   int x, y;
+   TimeType time;
+} PopupHoverType;
+
 static PopupType popup;
+static PopupHoverType hover;
 
 static void MeasurePopupText();
+static void HidePopup(void);
 static void SignalPopup(const TimeType *now, int x, int y, Window w,
                         void *data);
 
@@ -43,6 +57,12 @@ void StartupPopup(void)
 {
    popup.text = NULL;
    popup.window = None;
+   popup.pmap = None;
+   popup.pmapWidth = 0;
+   popup.pmapHeight = 0;
+   popup.mapped = 0;
+   hover.callback = NULL;
+   hover.object = NULL;
    RegisterCallback(100, SignalPopup, NULL);
 }
 
@@ -50,6 +70,8 @@ void StartupPopup(void)
 void ShutdownPopup(void)
 {
    UnregisterCallback(SignalPopup, NULL);
+   hover.callback = NULL;
+   hover.object = NULL;
    if(popup.text) {
       Release(popup.text);
       Release(popup.lines);
@@ -57,9 +79,47 @@ void ShutdownPopup(void)
    }
    if(popup.window != None) {
       JXDestroyWindow(display, popup.window);
-      JXFreePixmap(display, popup.pmap);
+      ForgetWindowProperties(popup.window);
       popup.window = None;
    }
+   if(popup.pmap != None) {
+      JXFreePixmap(display, popup.pmap);
+      popup.pmap = None;
+   }
+}
+
+/** Note that the mouse is over an object that has a popup. */
+void HoverPopup(PopupTextCallback callback, void *object,
+                PopupMaskType context, Window w, int x, int y)
+{
+   if(!(settings.popupMask & context)) {
+      return;
+   }
+
+   /* Small movements over the same object do not restart the delay. */
+   if(   hover.object == object && hover.callback == callback
+      && hover.window == w
+      && abs(hover.x - x) < settings.doubleClickDelta
+      && abs(hover.y - y) < settings.doubleClickDelta) {
+      return;
+   }
+
+   hover.callback = callback;
+   hover.object = object;
+   hover.context = context;
+   hover.window = w;
+   hover.x = x;
+   hover.y = y;
+   GetCurrentTime(&hover.time);
+}
+
+/** Stop tracking an object for popups. */
+void CancelPopupHover(const void *object)
+{
+   if(hover.object == object) {
+      hover.callback = NULL;
+      hover.object = NULL;
+   }
 }
 
 /** Calculate dimensions of a popup window given the popup text. */
@@ -106,7 +166,8 @@ void ShowPopup(int x, int y, const char *text,
    }
 
    if(popup.text) {
-      if(x == popup.x && y == popup.y && !strcmp(popup.text, text)) {
+      if(popup.mapped && x == popup.x && y == popup.y
+         && !strcmp(popup.text, text)) {
          /* This popup is already shown. */
          return;
       }
@@ -171,19 +232,29 @@ void ShowPopup(int x, int y, const char *text,
                                     CopyFromParent, attrMask, &attr);
       SetAtomAtom(popup.window, ATOM_NET_WM_WINDOW_TYPE,
                   ATOM_NET_WM_WINDOW_TYPE_NOTIFICATION);
-      JXMapRaised(display, popup.window);
 
    } else {
 
       JXMoveResizeWindow(display, popup.window, popup.x, popup.y,
                          popup.width, popup.height);
-      JXFreePixmap(display, popup.pmap);
 
    }
+   if(!popup.mapped) {
+      JXMapRaised(display, popup.window);
+      popup.mapped = 1;
+   }
 
-   popup.pmap = JXCreatePixmap(display, popup.window,
-                               popup.width, popup.height,
-                               rootDepth);
+   /* Reuse the pixmap unless it is too small. */
+   if(popup.width > popup.pmapWidth || popup.height > popup.pmapHeight) {
+      if(popup.pmap != None) {
+         JXFreePixmap(display, popup.pmap);
+      }
+      popup.pmapWidth = Max(popup.width, popup.pmapWidth);
+      popup.pmapHeight = Max(popup.height, popup.pmapHeight);
+      popup.pmap = JXCreatePixmap(display, popup.window,
+                                  popup.pmapWidth, popup.pmapHeight,
+                                  rootDepth);
+   }
 
    JXSetForeground(display, rootGC, colors[COLOR_POPUP_BG]);
    JXFillRectangle(display, popup.pmap, rootGC, 0, 0,
@@ -203,15 +274,47 @@ void ShowPopup(int x, int y, const char *text,
 
 }
 
-/** Signal popup (this is used to hide popups after awhile). */
+/** Hide the popup window.
+ * The window and pixmap are kept for the next popup.
+ */
+void HidePopup(void)
+{
+   if(popup.mapped) {
+      JXUnmapWindow(display, popup.window);
+      popup.mapped = 0;
+   }
+}
+
+/** Signal popup.
+ * This shows the popup for the object under the mouse once the mouse
+ * has rested and hides popups once the mouse moves.
+ */
 void SignalPopup(const TimeType *now, int x, int y, Window w, void *data)
 {
-   if(popup.window != None) {
+   if(popup.mapped) {
       if(popup.mw != w ||
          abs(popup.mx - x) > 0 || abs(popup.my - y) > 0) {
-         JXDestroyWindow(display, popup.window);
-         JXFreePixmap(display, popup.pmap);
-         popup.window = None;
+         HidePopup();
+      }
+   }
+
+   if(hover.callback) {
+      if(   (hover.window != None && hover.window != w)
+         || abs(hover.x - x) >= settings.doubleClickDelta
+         || abs(hover.y - y) >= settings.doubleClickDelta) {
+
+         /* The mouse left the object or moved on without motion events
+          * reaching the object. */
+         hover.callback = NULL;
+         hover.object = NULL;
+
+      } else if(GetTimeDifference(now, &hover.time) >= settings.popupDelay) {
+         const char *text = (hover.callback)(hover.object, x, y);
+         hover.callback = NULL;
+         hover.object = NULL;
+         if(text) {
+            ShowPopup(x, y, text, hover.context);
+         }
       }
    }
 }
@@ -224,9 +327,7 @@ char ProcessPopupEvent(const XEvent *event)
          JXCopyArea(display, popup.pmap, popup.window, rootGC,
                     0, 0, popup.width, popup.height, 0, 0);
       } else if(event->type == MotionNotify) {
-         JXDestroyWindow(display, popup.window);
-         JXFreePixmap(display, popup.pmap);
-         popup.window = None;
+         HidePopup();
       }
       return 1;
    }
@@ -19,6 +19,34 @@ void ShutdownPopup(void);
 #define DestroyPopup()     (void)(0)
 /*@}*/
 
+/** Callback to get the text for a popup.
+ * @param object The object that was registered with HoverPopup.
+ * @param x The mouse x-coordinate (root relative).
+ * @param y The mouse y-coordinate (root relative).
+ * @return The popup text (NULL for no popup).
+ */
+typedef const char *(*PopupTextCallback)(void *object, int x, int y);
+
+/** Note that the mouse is over an object that has a popup.
+ * This should be called on mouse motion over the object. The popup is
+ * shown if the mouse then rests for the popup delay. Only one object
+ * is tracked at a time, so there is no polling per object.
+ * @param callback Callback to get the popup text.
+ * @param object The object to pass to the callback.
+ * @param context The popup context.
+ * @param w The window the mouse must stay on (None for any window).
+ * @param x The mouse x-coordinate (root relative).
+ * @param y The mouse y-coordinate (root relative).
+ */
+void HoverPopup(PopupTextCallback callback, void *object,
+                PopupMaskType context, Window w, int x, int y);
+
+/** Stop tracking an object for popups.
+ * This must be called before an object passed to HoverPopup goes away.
+ * @param object The object.
+ */
+void CancelPopupHover(const void *object);
+
 /** Show a popup window.
  * @param x The x coordinate of the left edge of the popup window.
  * @param y The y coordinate of the bottom edge of the popup window.
@@ -45,6 +45,18 @@ void StartupRootMenu(void)
    unsigned int x, y;
    char found;
 
+   /* Start loading menu icons and dynamic menus in the background. */
+   for(x = 0; x < ROOT_MENU_COUNT; x++) {
+      if(rootMenu[x]) {
+         PrefetchMenuIcons(rootMenu[x]);
+         if(rootMenu[x]->dynamic) {
+            PrefetchDynamicMenu(rootMenu[x]->dynamic,
+                                rootMenu[x]->timeout_ms,
+                                rootMenu[x]->ttl_ms);
+         }
+      }
+   }
+
    for(x = 0; x < ROOT_MENU_COUNT; x++) {
       if(rootMenu[x]) {
          found = 0;
@@ -190,7 +202,7 @@ char ShowRootMenu(int index, int x, int y, char keyboard)
    }
    if(rootMenu[index]->dynamic) {
       Menu *menu = rootMenu[index];
-      menu = ParseDynamicMenu(menu->timeout_ms, menu->dynamic);
+      menu = GetDynamicMenu(menu->dynamic, menu->timeout_ms, menu->ttl_ms);
       if(menu) {
          InitializeMenu(menu);
          ShowMenu(menu, RunRootCommand, x, y, keyboard);
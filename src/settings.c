@@ -42,6 +42,8 @@ void InitializeSettings(void)
    settings.resizeMode = RESIZE_OPAQUE;
    settings.popupDelay = 600;
    settings.desktopDelay = 1000;
+   settings.focusDelay = 0;
+   settings.thumbnailDelay = 250;
    settings.trayOpacity = UINT_MAX;
    settings.popupMask = POPUP_ALL;
    settings.activeClientOpacity = UINT_MAX;
@@ -76,6 +78,9 @@ void StartupSettings(void)
    FixRange(&settings.doubleClickDelta, 0, 64, 2);
    FixRange(&settings.doubleClickSpeed, 1, 2000, 400);
 
+   FixRange(&settings.focusDelay, 0, 2000, 0);
+   FixRange(&settings.thumbnailDelay, 10, 10000, 250);
+
    FixRange(&settings.desktopWidth, 1, 64, 4);
    FixRange(&settings.desktopHeight, 1, 64, 1);
    settings.desktopCount = settings.desktopWidth * settings.desktopHeight;
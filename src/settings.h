@@ -99,6 +99,8 @@ typedef struct {
    unsigned desktopCount;
    unsigned menuOpacity;
    unsigned desktopDelay;
+   unsigned focusDelay;
+   unsigned thumbnailDelay;
    unsigned cornerRadius;
    unsigned moveMask;
    unsigned dockSpacing;
@@ -0,0 +1,294 @@
+/**
+ * @file shm.c
+ * @author Joe Wingbermuehle
+ * @date 2026
+ *
+ * @brief Functions for uploading images using the X shared memory extension.
+ *
+ */
+
+#include "jwm.h"
+#include "shm.h"
+#include "main.h"
+#include "misc.h"
+
+#ifdef USE_SHM
+
+/** Images smaller than this are sent using XPutImage. */
+#define SHM_MIN_SIZE    (16 * 1024)
+
+/** Segment sizes are rounded up to a multiple of this. */
+#define SHM_GRANULARITY (64 * 1024)
+
+/** Maximum number of segments to keep in the pool. */
+#define SHM_POOL_SIZE   4
+
+/** Shared memory segment. */
+typedef struct ShmSegment {
+   XShmSegmentInfo info;   /**< Segment info (must be first). */
+   size_t size;            /**< Size of the segment in bytes. */
+   char inUse;             /**< Set if the segment is in use by an image. */
+   char pending;           /**< Set if the server may still read it. */
+} ShmSegment;
+
+static ShmSegment *segments[SHM_POOL_SIZE];
+static char haveShm;
+static char shmFailed;
+
+static ShmSegment *CreateSegment(size_t size);
+static void DestroySegment(ShmSegment *sp);
+static ShmSegment *AcquireSegment(size_t size);
+static int ShmErrorHandler(Display *d, XErrorEvent *e);
+static char IsLocalDisplay(void);
+
+#endif /* USE_SHM */
+
+/** Startup shared memory support. */
+void StartupShm(void)
+{
+#ifdef USE_SHM
+   unsigned int x;
+   for(x = 0; x < SHM_POOL_SIZE; x++) {
+      segments[x] = NULL;
+   }
+   haveShm = 0;
+   if(IsLocalDisplay() && JXShmQueryExtension(display)) {
+
+      /* Make sure we can actually attach a segment. */
+      ShmSegment *sp;
+      haveShm = 1;
+      sp = CreateSegment(SHM_GRANULARITY);
+      if(sp) {
+         segments[0] = sp;
+      } else {
+         haveShm = 0;
+      }
+
+   }
+   if(haveShm) {
+      Debug("shared memory extension enabled");
+   } else {
+      Debug("shared memory extension disabled");
+   }
+#endif
+}
+
+/** Shutdown shared memory support. */
+void ShutdownShm(void)
+{
+#ifdef USE_SHM
+   unsigned int x;
+   for(x = 0; x < SHM_POOL_SIZE; x++) {
+      if(segments[x]) {
+         Assert(!segments[x]->inUse);
+         DestroySegment(segments[x]);
+         segments[x] = NULL;
+      }
+   }
+   haveShm = 0;
+#endif
+}
+
+/** Create an image for uploading. */
+XImage *CreateImageBuffer(int depth, unsigned width, unsigned height)
+{
+   XImage *image;
+
+#ifdef USE_SHM
+   if(haveShm) {
+      XShmSegmentInfo dummy;
+      image = JXShmCreateImage(display, rootVisual, depth, ZPixmap,
+                               NULL, &dummy, width, height);
+      if(image) {
+         const size_t size = image->bytes_per_line * height;
+         ShmSegment *sp = NULL;
+         if(size >= SHM_MIN_SIZE) {
+            sp = AcquireSegment(size);
+         }
+         if(sp) {
+            sp->inUse = 1;
+            image->obdata = (char*)&sp->info;
+            image->data = sp->info.shmaddr;
+            return image;
+         }
+         image->obdata = NULL;
+         JXDestroyImage(image);
+      }
+   }
+#endif
+
+   image = JXCreateImage(display, rootVisual, depth, ZPixmap, 0, NULL,
+                         width, height, 8, 0);
+   image->data = Allocate(image->bytes_per_line * height);
+   return image;
+}
+
+/** Upload an image to a drawable. */
+void PutImageBuffer(Drawable d, GC gc, XImage *image,
+                    int x, int y, unsigned width, unsigned height)
+{
+#ifdef USE_SHM
+   if(image->obdata) {
+      ShmSegment *sp = (ShmSegment*)image->obdata;
+      JXShmPutImage(display, d, gc, image, 0, 0, x, y,
+                    width, height, False);
+      sp->pending = 1;
+      return;
+   }
+#endif
+   JXPutImage(display, d, gc, image, 0, 0, x, y, width, height);
+}
+
+/** Destroy an image created for uploading. */
+void DestroyImageBuffer(XImage *image)
+{
+#ifdef USE_SHM
+   if(image->obdata) {
+      ShmSegment *sp = (ShmSegment*)image->obdata;
+      sp->inUse = 0;
+      image->obdata = NULL;
+      image->data = NULL;
+      JXDestroyImage(image);
+      return;
+   }
+#endif
+   Release(image->data);
+   image->data = NULL;
+   JXDestroyImage(image);
+}
+
+#ifdef USE_SHM
+
+/** Get a free segment of at least the specified size. */
+ShmSegment *AcquireSegment(size_t size)
+{
+   ShmSegment *best = NULL;
+   int emptyIndex = -1;
+   int victimIndex = -1;
+   unsigned int x;
+
+   /* Find the smallest idle segment that is large enough. */
+   for(x = 0; x < SHM_POOL_SIZE; x++) {
+      ShmSegment *sp = segments[x];
+      if(!sp) {
+         if(emptyIndex < 0) {
+            emptyIndex = x;
+         }
+      } else if(!sp->inUse) {
+         if(sp->size >= size) {
+            if(!best || sp->size < best->size) {
+               best = sp;
+            }
+         } else if(victimIndex < 0
+                   || sp->size < segments[victimIndex]->size) {
+            victimIndex = x;
+         }
+      }
+   }
+
+   /* If nothing fits, create a new segment, replacing the smallest
+    * idle segment if the pool is full. */
+   if(!best) {
+      if(emptyIndex < 0) {
+         if(victimIndex < 0) {
+            return NULL;
+         }
+         DestroySegment(segments[victimIndex]);
+         segments[victimIndex] = NULL;
+         emptyIndex = victimIndex;
+      }
+      size = (size + SHM_GRANULARITY - 1) & ~(size_t)(SHM_GRANULARITY - 1);
+      best = CreateSegment(size);
+      segments[emptyIndex] = best;
+   }
+
+   /* Make sure the server is done with the segment before we reuse it.
+    * A single round trip covers every outstanding upload. */
+   if(best && best->pending) {
+      JXSync(display, False);
+      for(x = 0; x < SHM_POOL_SIZE; x++) {
+         if(segments[x]) {
+            segments[x]->pending = 0;
+         }
+      }
+   }
+
+   return best;
+}
+
+/** Create and attach a shared memory segment. */
+ShmSegment *CreateSegment(size_t size)
+{
+   ShmSegment *sp;
+   XErrorHandler oldHandler;
+
+   sp = Allocate(sizeof(ShmSegment));
+   sp->size = size;
+   sp->inUse = 0;
+   sp->pending = 0;
+   sp->info.readOnly = True;
+   sp->info.shmid = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600);
+   if(JUNLIKELY(sp->info.shmid < 0)) {
+      Release(sp);
+      return NULL;
+   }
+   sp->info.shmaddr = shmat(sp->info.shmid, NULL, 0);
+   if(JUNLIKELY(sp->info.shmaddr == (char*)-1)) {
+      shmctl(sp->info.shmid, IPC_RMID, NULL);
+      Release(sp);
+      return NULL;
+   }
+
+   /* Attach the segment, catching errors in case the server is not
+    * able to see our segment. */
+   shmFailed = 0;
+   JXSync(display, False);
+   oldHandler = JXSetErrorHandler(ShmErrorHandler);
+   JXShmAttach(display, &sp->info);
+   JXSync(display, False);
+   JXSetErrorHandler(oldHandler);
+
+   /* Both sides are attached (or the attach failed), so mark the segment
+    * for removal. It will go away once both sides detach. */
+   shmctl(sp->info.shmid, IPC_RMID, NULL);
+
+   if(JUNLIKELY(shmFailed)) {
+      shmdt(sp->info.shmaddr);
+      Release(sp);
+      haveShm = 0;
+      return NULL;
+   }
+
+   return sp;
+}
+
+/** Detach and destroy a shared memory segment. */
+void DestroySegment(ShmSegment *sp)
+{
+   JXShmDetach(display, &sp->info);
+   JXSync(display, False);
+   shmdt(sp->info.shmaddr);
+   Release(sp);
+}
+
+/** Error handler used while attaching a segment. */
+int ShmErrorHandler(Display *d, XErrorEvent *e)
+{
+   shmFailed = 1;
+   return 0;
+}
+
+/** Determine if the X server is on the local machine. */
+char IsLocalDisplay(void)
+{
+   const char *name = DisplayString(display);
+   if(name[0] == ':') {
+      return 1;
+   }
+   if(!strncmp(name, "unix:", 5)) {
+      return 1;
+   }
+   return 0;
+}
+
+#endif /* USE_SHM */
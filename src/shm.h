@@ -0,0 +1,49 @@
+/**
+ * @file shm.h
+ * @author Joe Wingbermuehle
+ * @date 2026
+ *
+ * @brief Functions for uploading images using the X shared memory extension.
+ *
+ */
+
+#ifndef SHM_H
+#define SHM_H
+
+/*@{*/
+#define InitializeShm()    (void)(0)
+void StartupShm(void);
+void ShutdownShm(void);
+#define DestroyShm()       (void)(0)
+/*@}*/
+
+/** Create an image suitable for uploading to the server.
+ * If the shared memory extension is available and the server is local,
+ * the image data will be placed in a shared memory segment from a pool
+ * of reusable segments. Otherwise the image data is allocated normally.
+ * @param depth The depth of the image.
+ * @param width The width of the image.
+ * @param height The height of the image.
+ * @return The image (must be released with DestroyImageBuffer).
+ */
+XImage *CreateImageBuffer(int depth, unsigned width, unsigned height);
+
+/** Upload an image created with CreateImageBuffer to a drawable.
+ * @param d The destination drawable.
+ * @param gc The graphics context to use.
+ * @param image The image to upload.
+ * @param x The x-coordinate on the destination drawable.
+ * @param y The y-coordinate on the destination drawable.
+ * @param width The width to upload.
+ * @param height The height to upload.
+ */
+void PutImageBuffer(Drawable d, GC gc, XImage *image,
+                    int x, int y, unsigned width, unsigned height);
+
+/** Destroy an image created with CreateImageBuffer.
+ * Shared memory segments are returned to the pool for reuse.
+ * @param image The image to destroy.
+ */
+void DestroyImageBuffer(XImage *image);
+
+#endif /* SHM_H */
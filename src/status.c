@@ -136,6 +136,7 @@ void DestroyMoveResizeWindow(void)
 {
    if(statusWindow != None) {
       JXDestroyWindow(display, statusWindow);
+      ForgetWindowProperties(statusWindow);
       statusWindow = None;
    }
 }
@@ -27,6 +27,17 @@
 #include "misc.h"
 #include "desktop.h"
 
+struct TaskEntry;
+
+/** The state of an item as it was last drawn on a task bar. */
+typedef struct TaskItem {
+   const struct TaskEntry *entry;   /**< The entry drawn. */
+   const IconNode *icon;            /**< The icon drawn. */
+   unsigned iconSerial;             /**< Serial of the client icon drawn. */
+   char *text;                      /**< The text drawn (may be NULL). */
+   ButtonType type;                 /**< The button type drawn. */
+} TaskItem;
+
 typedef struct TaskBarType {
 
    TrayComponentType *cp;
@@ -41,34 +52,55 @@ typedef struct TaskBarType {
 
    Pixmap buffer;
 
-   TimeType mouseTime;
-   int mousex, mousey;
+   TaskItem *items;        /**< Items as last drawn. */
+   int itemCount;          /**< Number of items drawn (-1 if invalid). */
+   int renderedWidth;      /**< Item width when last drawn. */
+   int renderedHeight;     /**< Item height when last drawn. */
 
 } TaskBarType;
 
 typedef struct ClientEntry {
    ClientNode *client;
+   struct TaskEntry *task;    /**< The task entry containing this client. */
    struct ClientEntry *next;
    struct ClientEntry *prev;
 } ClientEntry;
 
 typedef struct TaskEntry {
    ClientEntry *clients;
+   char *className;           /**< Class name if grouped by class. */
    struct TaskEntry *next;
    struct TaskEntry *prev;
+   struct TaskEntry *hashNext;   /**< Next entry in the class hash. */
 } TaskEntry;
 
+/** Number of buckets in the class name hash (must be a power of 2). */
+#define TASK_HASH_SIZE 64
+
 static TaskBarType *bars;
 static TaskEntry *taskEntries;
 static TaskEntry *taskEntriesTail;
+static TaskEntry *taskHash[TASK_HASH_SIZE];
+
+/** Window lists as last written to the root window.
+ * The counts are -1 if nothing has been written yet. */
+static Window *clientList;
+static int clientListCount;
+static Window *stackingList;
+static int stackingListCount;
 
 static void ComputeItemSize(TaskBarType *tp);
 static char ShouldShowEntry(const TaskEntry *tp);
 static char ShouldFocusEntry(const TaskEntry *tp);
 static TaskEntry *GetEntry(TaskBarType *bar, int x, int y);
-static void Render(const TaskBarType *bp);
+static void Render(TaskBarType *bp);
+static void InvalidateItems(TaskBarType *bp);
 static void ShowClientList(TaskBarType *bar, TaskEntry *tp);
 static void RunTaskBarCommand(MenuAction *action, unsigned button);
+static unsigned int GetTaskHash(const char *className);
+static void PublishWindowList(AtomType atom, Window **published,
+                              int *publishedCount,
+                              const Window *windows, int count);
 
 static void SetSize(TrayComponentType *cp, int width, int height);
 static void Create(TrayComponentType *cp);
@@ -80,8 +112,7 @@ static void FocusGroup(const TaskEntry *tp);
 static char IsGroupOnTop(const TaskEntry *entry);
 static void ProcessTaskMotionEvent(TrayComponentType *cp,
                                    int x, int y, int mask);
-static void SignalTaskbar(const TimeType *now, int x, int y, Window w,
-                          void *data);
+static const char *GetTaskPopup(void *object, int x, int y);
 
 /** Initialize task bar data. */
 void InitializeTaskBar(void)
@@ -89,6 +120,11 @@ void InitializeTaskBar(void)
    bars = NULL;
    taskEntries = NULL;
    taskEntriesTail = NULL;
+   memset(taskHash, 0, sizeof(taskHash));
+   clientList = NULL;
+   clientListCount = -1;
+   stackingList = NULL;
+   stackingListCount = -1;
 }
 
 /** Shutdown the task bar. */
@@ -98,6 +134,16 @@ void ShutdownTaskBar(void)
    for(bp = bars; bp; bp = bp->next) {
       JXFreePixmap(display, bp->buffer);
    }
+   if(clientList) {
+      Release(clientList);
+      clientList = NULL;
+   }
+   clientListCount = -1;
+   if(stackingList) {
+      Release(stackingList);
+      stackingList = NULL;
+   }
+   stackingListCount = -1;
 }
 
 /** Destroy task bar data. */
@@ -106,7 +152,10 @@ void DestroyTaskBar(void)
    TaskBarType *bp;
    while(bars) {
       bp = bars->next;
-      UnregisterCallback(SignalTaskbar, bars);
+      InvalidateItems(bars);
+      if(bars->items) {
+         Release(bars->items);
+      }
       Release(bars);
       bars = bp;
    }
@@ -128,10 +177,8 @@ TrayComponentType *CreateTaskBar()
    tp->maxItemWidth = 0;
    tp->layout = LAYOUT_HORIZONTAL;
    tp->labeled = 1;
-   tp->mousex = -settings.doubleClickDelta;
-   tp->mousey = -settings.doubleClickDelta;
-   tp->mouseTime.seconds = 0;
-   tp->mouseTime.ms = 0;
+   tp->items = NULL;
+   tp->itemCount = -1;
 
    cp = CreateTrayComponent();
    cp->object = tp;
@@ -143,8 +190,6 @@ TrayComponentType *CreateTaskBar()
    cp->ProcessButtonPress = ProcessTaskButtonEvent;
    cp->ProcessMotionEvent = ProcessTaskMotionEvent;
 
-   RegisterCallback(settings.popupDelay / 2, SignalTaskbar, tp);
-
    return cp;
 
 }
@@ -171,6 +216,7 @@ void Create(TrayComponentType *cp)
    cp->pixmap = JXCreatePixmap(display, rootWindow, cp->width, cp->height,
                                rootDepth);
    tp->buffer = cp->pixmap;
+   InvalidateItems(tp);
    ClearTrayDrawable(cp);
 }
 
@@ -184,6 +230,7 @@ void Resize(TrayComponentType *cp)
    cp->pixmap = JXCreatePixmap(display, rootWindow, cp->width, cp->height,
                                rootDepth);
    tp->buffer = cp->pixmap;
+   InvalidateItems(tp);
    ClearTrayDrawable(cp);
 }
 
@@ -459,9 +506,8 @@ void FocusGroup(const TaskEntry *tp)
 void ProcessTaskMotionEvent(TrayComponentType *cp, int x, int y, int mask)
 {
    TaskBarType *bp = (TaskBarType*)cp->object;
-   bp->mousex = cp->screenx + x;
-   bp->mousey = cp->screeny + y;
-   GetCurrentTime(&bp->mouseTime);
+   HoverPopup(GetTaskPopup, bp, POPUP_TASK, cp->tray->window,
+              cp->screenx + x, cp->screeny + y);
 }
 
 /** Show the menu associated with a task list item. */
@@ -625,13 +671,13 @@ void AddClientToTaskBar(ClientNode *np)
    TaskEntry *tp = NULL;
    ClientEntry *cp = Allocate(sizeof(ClientEntry));
    cp->client = np;
+   np->taskEntry = cp;
 
+   /* Look up the group for this client. */
    if(np->className && settings.groupTasks) {
-      for(tp = taskEntries; tp; tp = tp->next) {
-         const char *className = tp->clients->client->className;
-         if(className && !strcmp(np->className, className)) {
-            break;
-         }
+      tp = taskHash[GetTaskHash(np->className)];
+      while(tp && strcmp(np->className, tp->className)) {
+         tp = tp->hashNext;
       }
    }
    if(tp == NULL) {
@@ -645,8 +691,18 @@ void AddClientToTaskBar(ClientNode *np)
          taskEntries = tp;
       }
       taskEntriesTail = tp;
+      if(np->className && settings.groupTasks) {
+         const unsigned int index = GetTaskHash(np->className);
+         tp->className = CopyString(np->className);
+         tp->hashNext = taskHash[index];
+         taskHash[index] = tp;
+      } else {
+         tp->className = NULL;
+         tp->hashNext = NULL;
+      }
    }
 
+   cp->task = tp;
    cp->next = tp->clients;
    if(tp->clients) {
       tp->clients->prev = cp;
@@ -655,46 +711,67 @@ void AddClientToTaskBar(ClientNode *np)
    tp->clients = cp;
 
    RequireTaskUpdate();
-   UpdateNetClientList();
+   RequireClientListUpdate();
 
 }
 
 /** Remove a client from the task bar. */
 void RemoveClientFromTaskBar(ClientNode *np)
 {
+   ClientEntry *cp = np->taskEntry;
    TaskEntry *tp;
-   for(tp = taskEntries; tp; tp = tp->next) {
-      ClientEntry *cp;
-      for(cp = tp->clients; cp; cp = cp->next) {
-         if(cp->client == np) {
-            if(cp->prev) {
-               cp->prev->next = cp->next;
-            } else {
-               tp->clients = cp->next;
-            }
-            if(cp->next) {
-               cp->next->prev = cp->prev;
-            }
-            Release(cp);
-            if(!tp->clients) {
-               if(tp->prev) {
-                  tp->prev->next = tp->next;
-               } else {
-                  taskEntries = tp->next;
-               }
-               if(tp->next) {
-                  tp->next->prev = tp->prev;
-               } else {
-                  taskEntriesTail = tp->prev;
-               }
-               Release(tp);
-            }
-            RequireTaskUpdate();
-            UpdateNetClientList();
-            return;
+
+   if(!cp) {
+      return;
+   }
+   np->taskEntry = NULL;
+
+   tp = cp->task;
+   if(cp->prev) {
+      cp->prev->next = cp->next;
+   } else {
+      tp->clients = cp->next;
+   }
+   if(cp->next) {
+      cp->next->prev = cp->prev;
+   }
+   Release(cp);
+
+   if(!tp->clients) {
+      if(tp->prev) {
+         tp->prev->next = tp->next;
+      } else {
+         taskEntries = tp->next;
+      }
+      if(tp->next) {
+         tp->next->prev = tp->prev;
+      } else {
+         taskEntriesTail = tp->prev;
+      }
+      if(tp->className) {
+         TaskEntry **tpp = &taskHash[GetTaskHash(tp->className)];
+         while(*tpp != tp) {
+            tpp = &(*tpp)->hashNext;
          }
+         *tpp = tp->hashNext;
+         Release(tp->className);
       }
+      Release(tp);
+   }
+
+   RequireTaskUpdate();
+   RequireClientListUpdate();
+}
+
+/** Get the hash bucket for a class name. */
+unsigned int GetTaskHash(const char *className)
+{
+   unsigned int hash = 0;
+   unsigned int x;
+   for(x = 0; className[x]; x++) {
+      hash = (hash + (hash << 5)) ^ (unsigned int)className[x];
    }
+   return hash & (TASK_HASH_SIZE - 1);
 }
 
 /** Update all task bars. */
@@ -732,48 +809,79 @@ void UpdateTaskBar(void)
    }
 }
 
-/** Signal task bar (for popups). */
-void SignalTaskbar(const TimeType *now, int x, int y, Window w, void *data)
+/** Get the popup text for a task bar. */
+const char *GetTaskPopup(void *object, int x, int y)
 {
 
-   TaskBarType *bp = (TaskBarType*)data;
+   TaskBarType *bp = (TaskBarType*)object;
    TaskEntry *ep;
 
-   if(w == bp->cp->tray->window &&
-      abs(bp->mousex - x) < settings.doubleClickDelta &&
-      abs(bp->mousey - y) < settings.doubleClickDelta) {
-      if(GetTimeDifference(now, &bp->mouseTime) >= settings.popupDelay) {
-         ep = GetEntry(bp, x - bp->cp->screenx, y - bp->cp->screeny);
-         if(settings.groupTasks) {
-            if(ep && ep->clients->client->className) {
-               ShowPopup(x, y, ep->clients->client->className, POPUP_TASK);
-            }
-         } else {
-            if(ep && ep->clients->client->name) {
-               ShowPopup(x, y, ep->clients->client->name, POPUP_TASK);
-            }
-         }
-      }
+   ep = GetEntry(bp, x - bp->cp->screenx, y - bp->cp->screeny);
+   if(!ep) {
+      return NULL;
+   }
+   if(settings.groupTasks) {
+      return ep->clients->client->className;
+   } else {
+      return ep->clients->client->name;
    }
 
 }
 
-/** Draw a specific task bar. */
-void Render(const TaskBarType *bp)
+/** Forget what was drawn on a task bar so that it is fully redrawn. */
+void InvalidateItems(TaskBarType *bp)
+{
+   int i;
+   for(i = 0; i < bp->itemCount; i++) {
+      if(bp->items[i].text) {
+         Release(bp->items[i].text);
+      }
+   }
+   bp->itemCount = -1;
+}
+
+/** Draw a specific task bar.
+ * Only items that differ from what was last drawn are redrawn and
+ * copied to the tray. Everything is redrawn if the item count or size
+ * changes.
+ */
+void Render(TaskBarType *bp)
 {
    TaskEntry *tp;
    char *displayName;
    ButtonNode button;
    int x, y;
+   int itemCount;
+   int index;
+   char redrawAll;
 
    if(JUNLIKELY(shouldExit)) {
       return;
    }
 
-   ClearTrayDrawable(bp->cp);
-   if(!taskEntries) {
-      UpdateSpecificTray(bp->cp->tray, bp->cp);
-      return;
+   /* Determine if everything needs to be redrawn. */
+   itemCount = 0;
+   for(tp = taskEntries; tp; tp = tp->next) {
+      if(ShouldShowEntry(tp)) {
+         itemCount += 1;
+      }
+   }
+   redrawAll = itemCount != bp->itemCount
+            || bp->itemWidth != bp->renderedWidth
+            || bp->itemHeight != bp->renderedHeight;
+   if(redrawAll) {
+      InvalidateItems(bp);
+      if(bp->items) {
+         Release(bp->items);
+      }
+      bp->items = Allocate(sizeof(TaskItem) * (itemCount + 1));
+      for(index = 0; index < itemCount; index++) {
+         bp->items[index].text = NULL;
+      }
+      bp->itemCount = itemCount;
+      bp->renderedWidth = bp->itemWidth;
+      bp->renderedHeight = bp->itemHeight;
+      ClearTrayDrawable(bp->cp);
    }
 
    ResetButton(&button, bp->cp->pixmap);
@@ -785,8 +893,11 @@ void Render(const TaskBarType *bp)
 
    x = 0;
    y = 0;
+   index = 0;
    for(tp = taskEntries; tp; tp = tp->next) {
 
+      TaskItem *ip;
+
       if(!ShouldShowEntry(tp)) {
          continue;
       }
@@ -833,7 +944,29 @@ void Render(const TaskBarType *bp)
             button.text = tp->clients->client->name;
          }
       }
-      DrawButton(&button);
+
+      /* Draw the item if it changed. */
+      ip = &bp->items[index];
+      if(redrawAll || ip->entry != tp || ip->icon != button.icon
+         || ip->iconSerial != tp->clients->client->iconSerial
+         || ip->type != button.type
+         || (ip->text != button.text
+            && (!ip->text || !button.text
+               || strcmp(ip->text, button.text)))) {
+         DrawButton(&button);
+         if(ip->text) {
+            Release(ip->text);
+         }
+         ip->entry = tp;
+         ip->icon = button.icon;
+         ip->iconSerial = tp->clients->client->iconSerial;
+         ip->type = button.type;
+         ip->text = CopyString(button.text);
+         if(!redrawAll) {
+            UpdateSpecificTrayArea(bp->cp->tray, bp->cp, x, y,
+                                   bp->itemWidth, bp->itemHeight);
+         }
+      }
       if(displayName) {
          Release(displayName);
       }
@@ -843,9 +976,12 @@ void Render(const TaskBarType *bp)
       } else {
          y += bp->itemHeight;
       }
+      index += 1;
    }
 
-   UpdateSpecificTray(bp->cp->tray, bp->cp);
+   if(redrawAll) {
+      UpdateSpecificTray(bp->cp->tray, bp->cp);
+   }
 
 }
 
@@ -1030,7 +1166,7 @@ void UpdateNetClientList(void)
    TaskEntry *tp;
    ClientNode *client;
    Window *windows;
-   unsigned int count;
+   int count;
    int layer;
 
    /* Determine how much we need to allocate. */
@@ -1050,9 +1186,8 @@ void UpdateNetClientList(void)
       }
    }
    Assert(count <= clientCount);
-   JXChangeProperty(display, rootWindow, atoms[ATOM_NET_CLIENT_LIST],
-                    XA_WINDOW, 32, PropModeReplace,
-                    (unsigned char*)windows, count);
+   PublishWindowList(ATOM_NET_CLIENT_LIST, &clientList, &clientListCount,
+                     windows, count);
 
    /* Set _NET_CLIENT_LIST_STACKING */
    count = 0;
@@ -1062,12 +1197,48 @@ void UpdateNetClientList(void)
          count += 1;
       }
    }
-   JXChangeProperty(display, rootWindow, atoms[ATOM_NET_CLIENT_LIST_STACKING],
-                    XA_WINDOW, 32, PropModeReplace,
-                    (unsigned char*)windows, count);
+   PublishWindowList(ATOM_NET_CLIENT_LIST_STACKING,
+                     &stackingList, &stackingListCount, windows, count);
 
    if(windows != NULL) {
       ReleaseStack(windows);
    }
    
 }
+
+/** Write a window list property on the root window if it changed.
+ * If windows were only added to the end of the list, they are appended
+ * to the property instead of rewriting it.
+ */
+void PublishWindowList(AtomType atom, Window **published,
+                       int *publishedCount,
+                       const Window *windows, int count)
+{
+   const int oldCount = *publishedCount;
+   const size_t oldSize = oldCount > 0 ? oldCount * sizeof(Window) : 0;
+
+   if(oldCount == count
+      && (oldSize == 0 || !memcmp(*published, windows, oldSize))) {
+      return;
+   }
+
+   if(oldCount >= 0 && oldCount < count
+      && (oldSize == 0 || !memcmp(*published, windows, oldSize))) {
+      JXChangeProperty(display, rootWindow, atoms[atom], XA_WINDOW, 32,
+                       PropModeAppend, (unsigned char*)&windows[oldCount],
+                       count - oldCount);
+   } else {
+      JXChangeProperty(display, rootWindow, atoms[atom], XA_WINDOW, 32,
+                       PropModeReplace, (unsigned char*)windows, count);
+   }
+
+   if(*published) {
+      *published = Reallocate(*published, sizeof(Window) * (count + 1));
+   } else {
+      *published = Allocate(sizeof(Window) * (count + 1));
+   }
+   if(count > 0) {
+      memcpy(*published, windows, sizeof(Window) * count);
+   }
+   *publishedCount = count;
+}
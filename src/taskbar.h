@@ -60,7 +60,11 @@ void SetTaskBarHeight(struct TrayComponentType *cp, const char *value);
  */
 void SetTaskBarLabeled(struct TrayComponentType *cp, char value);
 
-/** Update the _NET_CLIENT_LIST property. */
+/** Update the _NET_CLIENT_LIST and _NET_CLIENT_LIST_STACKING properties.
+ * This is normally called through RequireClientListUpdate so that
+ * changes are published once per event loop iteration. The properties
+ * are only written if they changed.
+ */
 void UpdateNetClientList(void);
 
 #endif /* TASKBAR_H */
@@ -0,0 +1,358 @@
+/**
+ * @file thumbnail.c
+ * @author Joe Wingbermuehle
+ * @date 2026
+ *
+ * @brief Window thumbnails using the XComposite extension.
+ *
+ * Top-level windows are redirected automatically, so the server still
+ * draws them but keeps their contents off-screen where XRender can read
+ * them even when obscured. Each client keeps a scaled copy of its
+ * contents for each size requested (pagers may differ in size) that is
+ * refreshed only after XDamage reports a change and at most once every
+ * settings.thumbnailDelay milliseconds.
+ *
+ */
+
+#include "jwm.h"
+#include "thumbnail.h"
+#include "client.h"
+#include "clientlist.h"
+#include "border.h"
+#include "event.h"
+#include "main.h"
+#include "pager.h"
+#include "settings.h"
+#include "timing.h"
+
+#ifdef USE_COMPOSITE
+
+/** Maximum number of thumbnail sizes kept for a client. */
+#define MAX_THUMBNAIL_SIZES 4
+
+/** Scaled contents of a client at one size. */
+typedef struct ThumbnailSizeNode {
+   Pixmap pixmap;       /**< The scaled contents. */
+   Picture picture;     /**< Picture for the pixmap. */
+   int width;           /**< Width of the pixmap. */
+   int height;          /**< Height of the pixmap. */
+   char valid;          /**< Set if the pixmap has been rendered. */
+   struct ThumbnailSizeNode *next;
+} ThumbnailSizeNode;
+
+/** Cached thumbnails for a client. */
+typedef struct ThumbnailNode {
+   Window window;       /**< The window being tracked. */
+   Damage damage;       /**< Damage object for the window. */
+   ThumbnailSizeNode *sizes;  /**< Sizes, most recently used first. */
+   char damaged;        /**< Set if the window changed since rendered. */
+} ThumbnailNode;
+
+static char requested;
+static char redirected;
+static char refreshPending;
+
+static Window GetThumbnailWindow(const ClientNode *np);
+static char IsThumbnailVisible(const ClientNode *np);
+static void UpdateThumbnailWindow(ClientNode *np);
+static ThumbnailSizeNode *GetThumbnailSize(ThumbnailNode *tp,
+                                           int width, int height);
+static void DestroyThumbnailSize(ThumbnailSizeNode *sp);
+static void RenderThumbnail(ThumbnailSizeNode *sp, Picture source,
+                            int x, int y, int width, int height);
+static void RefreshThumbnail(const ClientNode *np);
+static void SignalThumbnails(const TimeType *now, int x, int y, Window w,
+                             void *data);
+
+#endif /* USE_COMPOSITE */
+
+/** Initialize thumbnail data. */
+void InitializeThumbnails(void)
+{
+#ifdef USE_COMPOSITE
+   requested = 0;
+   redirected = 0;
+   refreshPending = 0;
+#endif
+}
+
+/** Start redirecting windows if thumbnails were requested. */
+void StartupThumbnails(void)
+{
+#ifdef USE_COMPOSITE
+   if(requested && haveComposite) {
+      JXCompositeRedirectSubwindows(display, rootWindow,
+                                    CompositeRedirectAutomatic);
+      redirected = 1;
+   }
+#endif
+}
+
+/** Stop redirecting windows. */
+void ShutdownThumbnails(void)
+{
+#ifdef USE_COMPOSITE
+   if(refreshPending) {
+      CancelCallback(SignalThumbnails, NULL);
+      refreshPending = 0;
+   }
+   if(redirected) {
+      JXCompositeUnredirectSubwindows(display, rootWindow,
+                                      CompositeRedirectAutomatic);
+      redirected = 0;
+   }
+   requested = 0;
+#endif
+}
+
+/** Request thumbnails. */
+void RequestThumbnails(void)
+{
+#ifdef USE_COMPOSITE
+   requested = 1;
+#endif
+}
+
+/** Release the thumbnail for a client. */
+void RemoveThumbnail(ClientNode *np)
+{
+#ifdef USE_COMPOSITE
+   ThumbnailNode *tp = np->thumbnail;
+   if(tp) {
+      if(tp->window == GetThumbnailWindow(np)) {
+         JXDamageDestroy(display, tp->damage);
+      }
+      while(tp->sizes) {
+         ThumbnailSizeNode *sp = tp->sizes->next;
+         DestroyThumbnailSize(tp->sizes);
+         tp->sizes = sp;
+      }
+      Release(tp);
+      np->thumbnail = NULL;
+   }
+#endif
+}
+
+/** Get the thumbnail for a client. */
+Pixmap GetThumbnail(ClientNode *np, int width, int height)
+{
+#ifdef USE_COMPOSITE
+
+   ThumbnailNode *tp;
+   ThumbnailSizeNode *sp;
+   const char visible = IsThumbnailVisible(np);
+
+   if(!redirected || width <= 0 || height <= 0) {
+      return None;
+   }
+
+   tp = np->thumbnail;
+   if(tp == NULL) {
+      if(!visible) {
+         return None;
+      }
+      tp = Allocate(sizeof(ThumbnailNode));
+      tp->window = None;
+      tp->sizes = NULL;
+      tp->damaged = 0;
+      np->thumbnail = tp;
+   }
+   UpdateThumbnailWindow(np);
+
+   sp = GetThumbnailSize(tp, width, height);
+   if(visible && (!sp->valid || tp->damaged)) {
+      RefreshThumbnail(np);
+   }
+
+   return sp->valid ? sp->pixmap : None;
+
+#else
+
+   return None;
+
+#endif
+}
+
+#ifdef USE_COMPOSITE
+
+/** Handle a damage event. */
+void HandleDamageNotify(const XDamageNotifyEvent *event)
+{
+   ClientNode *np = FindClient(event->drawable);
+   if(np && np->thumbnail) {
+      np->thumbnail->damaged = 1;
+      if(!refreshPending) {
+         ScheduleCallback(settings.thumbnailDelay, SignalThumbnails, NULL);
+         refreshPending = 1;
+      }
+   } else {
+      JXDamageSubtract(display, event->damage, None, None);
+   }
+}
+
+/** Get the top-level window for a client. */
+Window GetThumbnailWindow(const ClientNode *np)
+{
+   return np->parent != None ? np->parent : np->window;
+}
+
+/** Determine if the contents of a client can be read. */
+char IsThumbnailVisible(const ClientNode *np)
+{
+   const unsigned int mask = STAT_MAPPED | STAT_HIDDEN | STAT_SHADED;
+   return (np->state.status & mask) == STAT_MAPPED;
+}
+
+/** Track damage on the current top-level window of a client.
+ * The frame is created and destroyed as the border changes.
+ */
+void UpdateThumbnailWindow(ClientNode *np)
+{
+   ThumbnailNode *tp = np->thumbnail;
+   const Window w = GetThumbnailWindow(np);
+   if(tp->window != w) {
+      /* Damage objects go away with their window, so only release
+       * the old one if the window (the client itself) still exists. */
+      if(tp->window == np->window) {
+         JXDamageDestroy(display, tp->damage);
+      }
+      tp->window = w;
+      tp->damage = JXDamageCreate(display, w, XDamageReportNonEmpty);
+      tp->damaged = 1;
+   }
+}
+
+/** Get the thumbnail of a client at a specific size.
+ * The size is moved to the front of the list. New sizes are scaled
+ * from the most recently used size so that windows that are not
+ * visible still have a thumbnail.
+ */
+ThumbnailSizeNode *GetThumbnailSize(ThumbnailNode *tp,
+                                    int width, int height)
+{
+   XRenderPictFormat *fp;
+   ThumbnailSizeNode **prev;
+   ThumbnailSizeNode *sp;
+   unsigned int count;
+
+   count = 0;
+   for(prev = &tp->sizes; *prev; prev = &(*prev)->next) {
+      sp = *prev;
+      if(sp->width == width && sp->height == height) {
+         *prev = sp->next;
+         sp->next = tp->sizes;
+         tp->sizes = sp;
+         return sp;
+      }
+      count += 1;
+   }
+
+   /* Drop the least recently used size if the list is full. */
+   if(count >= MAX_THUMBNAIL_SIZES) {
+      for(prev = &tp->sizes; (*prev)->next; prev = &(*prev)->next);
+      DestroyThumbnailSize(*prev);
+      *prev = NULL;
+   }
+
+   fp = JXRenderFindVisualFormat(display, rootVisual);
+   sp = Allocate(sizeof(ThumbnailSizeNode));
+   sp->pixmap = JXCreatePixmap(display, rootWindow, width, height,
+                               rootDepth);
+   sp->picture = JXRenderCreatePicture(display, sp->pixmap, fp, 0, NULL);
+   sp->width = width;
+   sp->height = height;
+   sp->valid = 0;
+   if(tp->sizes && tp->sizes->valid) {
+      RenderThumbnail(sp, tp->sizes->picture, 0, 0,
+                      tp->sizes->width, tp->sizes->height);
+      sp->valid = 1;
+   }
+   sp->next = tp->sizes;
+   tp->sizes = sp;
+   return sp;
+}
+
+/** Release a thumbnail size. */
+void DestroyThumbnailSize(ThumbnailSizeNode *sp)
+{
+   JXRenderFreePicture(display, sp->picture);
+   JXFreePixmap(display, sp->pixmap);
+   Release(sp);
+}
+
+/** Scale an area of a picture into a thumbnail. */
+void RenderThumbnail(ThumbnailSizeNode *sp, Picture source,
+                     int x, int y, int width, int height)
+{
+   XTransform xf;
+
+   memset(&xf, 0, sizeof(xf));
+   xf.matrix[0][0] = XDoubleToFixed((double)width / sp->width);
+   xf.matrix[0][2] = XDoubleToFixed(x);
+   xf.matrix[1][1] = XDoubleToFixed((double)height / sp->height);
+   xf.matrix[1][2] = XDoubleToFixed(y);
+   xf.matrix[2][2] = XDoubleToFixed(1);
+   JXRenderSetPictureTransform(display, source, &xf);
+   JXRenderSetPictureFilter(display, source, FilterBilinear, NULL, 0);
+   JXRenderComposite(display, PictOpSrc, source, None, sp->picture,
+                     0, 0, 0, 0, 0, 0, sp->width, sp->height);
+}
+
+/** Render all sizes of a thumbnail from the contents of its window. */
+void RefreshThumbnail(const ClientNode *np)
+{
+   ThumbnailNode *tp = np->thumbnail;
+   ThumbnailSizeNode *sp;
+   XRenderPictFormat *fp = JXRenderFindVisualFormat(display, rootVisual);
+   XRenderPictureAttributes pa;
+   Picture source;
+   int north, south, east, west;
+
+   if(np->parent != None) {
+      GetBorderSize(&np->state, &north, &south, &east, &west);
+   } else {
+      north = 0;
+      west = 0;
+   }
+
+   pa.subwindow_mode = IncludeInferiors;
+   source = JXRenderCreatePicture(display, tp->window, fp,
+                                  CPSubwindowMode, &pa);
+   for(sp = tp->sizes; sp; sp = sp->next) {
+      RenderThumbnail(sp, source, west, north, np->width, np->height);
+      sp->valid = 1;
+   }
+   JXRenderFreePicture(display, source);
+
+   JXDamageSubtract(display, tp->damage, None, None);
+   tp->damaged = 0;
+}
+
+/** Refresh damaged thumbnails. */
+void SignalThumbnails(const TimeType *now, int x, int y, Window w,
+                      void *data)
+{
+   ClientNode *np;
+   unsigned int layer;
+
+   refreshPending = 0;
+   for(layer = FIRST_LAYER; layer <= LAST_LAYER; layer++) {
+      for(np = nodes[layer]; np; np = np->next) {
+         ThumbnailNode *tp = np->thumbnail;
+         if(tp == NULL || !tp->damaged) {
+            continue;
+         }
+         if(IsThumbnailVisible(np)) {
+            UpdateThumbnailWindow(np);
+            RefreshThumbnail(np);
+            UpdatePagerClient(np);
+         } else {
+            /* The window will be damaged again when shown. */
+            JXDamageSubtract(display, tp->damage, None, None);
+            tp->damaged = 0;
+         }
+      }
+   }
+}
+
+#endif /* USE_COMPOSITE */
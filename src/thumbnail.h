@@ -0,0 +1,51 @@
+/**
+ * @file thumbnail.h
+ * @author Joe Wingbermuehle
+ * @date 2026
+ *
+ * @brief Window thumbnails using the XComposite extension.
+ *
+ */
+
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+struct ClientNode;
+
+/*@{*/
+void InitializeThumbnails(void);
+void StartupThumbnails(void);
+void ShutdownThumbnails(void);
+#define DestroyThumbnails()   (void)(0)
+/*@}*/
+
+/** Request thumbnails.
+ * This is called while parsing the configuration for each pager that
+ * shows thumbnails. Windows are only redirected if requested.
+ */
+void RequestThumbnails(void);
+
+/** Get the thumbnail for a client.
+ * A thumbnail is cached for each size and only rendered again when
+ * the window changes. Windows that are not visible keep their last
+ * thumbnail.
+ * @param np The client.
+ * @param width The width of the thumbnail.
+ * @param height The height of the thumbnail.
+ * @return The thumbnail or None if not available.
+ */
+Pixmap GetThumbnail(struct ClientNode *np, int width, int height);
+
+/** Release the thumbnail for a client.
+ * @param np The client.
+ */
+void RemoveThumbnail(struct ClientNode *np);
+
+#ifdef USE_COMPOSITE
+/** Handle a damage event.
+ * @param event The event.
+ */
+void HandleDamageNotify(const XDamageNotifyEvent *event);
+#endif
+
+#endif /* THUMBNAIL_H */
@@ -28,11 +28,16 @@
 
 #define TRAY_BORDER_SIZE   1
 
+/** Time between steps when sliding a tray.
+ * This is about one frame at 60 Hz. */
+#define TRAY_SLIDE_DELAY   16
+
 static TrayType *trays;
 static unsigned int trayCount;
 
 static void HandleTrayExpose(TrayType *tp, const XExposeEvent *event);
 static void HandleTrayEnterNotify(TrayType *tp, const XCrossingEvent *event);
+static void HandleTrayLeaveNotify(TrayType *tp, const XCrossingEvent *event);
 
 static TrayComponentType *GetTrayComponent(TrayType *tp, int x, int y);
 static void HandleTrayButtonPress(TrayType *tp, const XButtonEvent *event);
@@ -49,8 +54,12 @@ static char CheckVerticalFill(TrayType *tp);
 static void LayoutTray(TrayType *tp, int *variableSize,
                        int *variableRemainder);
 
+static void ScheduleHideTray(TrayType *tp);
+static void MoveTrayWindow(TrayType *tp, int x, int y);
 static void SignalTray(const TimeType *now, int x, int y, Window w,
                        void *data);
+static void SignalTraySlide(const TimeType *now, int x, int y, Window w,
+                            void *data);
 
 
 /** Initialize tray data. */
@@ -92,6 +101,7 @@ void StartupTray(void)
          | KeyPressMask
          | KeyReleaseMask
          | EnterWindowMask
+         | LeaveWindowMask
          | PointerMotionMask;
 
       attrMask |= CWBackPixel;
@@ -103,6 +113,8 @@ void StartupTray(void)
                                   tp->x, tp->y, tp->width, tp->height, 0,
                                   rootDepth, InputOutput,
                                   rootVisual, attrMask, &attr);
+      tp->windowx = tp->targetx = tp->x;
+      tp->windowy = tp->targety = tp->y;
       SetAtomAtom(tp->window, ATOM_NET_WM_WINDOW_TYPE,
                   ATOM_NET_WM_WINDOW_TYPE_DOCK);
 
@@ -162,8 +174,12 @@ void StartupTray(void)
          }
       }
 
-      /* Show the tray. */
+      /* Show the tray.
+       * If the mouse is over the tray, the EnterNotify event will
+       * cancel the hide. */
       JXMapWindow(display, tp->window);
+      tp->pointerInside = 0;
+      ScheduleHideTray(tp);
 
       trayCount += 1;
 
@@ -185,7 +201,10 @@ void ShutdownTray(void)
             (cp->Destroy)(cp);
          }
       }
+      CancelCallback(SignalTray, tp);
+      CancelCallback(SignalTraySlide, tp);
       JXDestroyWindow(display, tp->window);
+      ForgetWindowProperties(tp->window);
    }
 }
 
@@ -197,9 +216,6 @@ void DestroyTray(void)
 
    while(trays) {
       tp = trays->next;
-      if(trays->autoHide != THIDE_OFF) {
-         UnregisterCallback(SignalTray, trays);
-      }
       while(trays->components) {
          cp = trays->components->next;
          Release(trays->components);
@@ -231,10 +247,11 @@ TrayType *CreateTray(void)
    tp->valign = TALIGN_FIXED;
    tp->halign = TALIGN_FIXED;
 
-   GetCurrentTime(&tp->showTime);
    tp->autoHide = THIDE_OFF;
    tp->autoHideDelay = 0;
    tp->hidden = 0;
+   tp->pointerInside = 0;
+   tp->slide = 0;
 
    tp->window = None;
 
@@ -539,21 +556,53 @@ void ComputeTraySize(TrayType *tp)
 /** Display a tray (for autohide). */
 void ShowTray(TrayType *tp)
 {
-   Window win1, win2;
-   int winx, winy;
-   unsigned int mask;
-   int mousex, mousey;
-
    if(tp->hidden) {
-
       tp->hidden = 0;
-      GetCurrentTime(&tp->showTime);
-      JXMoveWindow(display, tp->window, tp->x, tp->y);
+      MoveTrayWindow(tp, tp->x, tp->y);
+      ScheduleHideTray(tp);
+   }
+}
 
-      JXQueryPointer(display, rootWindow, &win1, &win2,
-                     &mousex, &mousey, &winx, &winy, &mask);
-      SetMousePosition(mousex, mousey, win2);
+/** Start the autohide timer for a tray.
+ * This is done when the mouse leaves the tray (or the tray is shown
+ * without the mouse over it). Entering the tray cancels the timer.
+ */
+void ScheduleHideTray(TrayType *tp)
+{
+   if(   tp->autoHide != THIDE_OFF && !tp->hidden && !tp->pointerInside
+      && !(tp->autoHide & THIDE_RAISED)) {
+      ScheduleCallback(tp->autoHideDelay, SignalTray, tp);
+   }
+}
 
+/** Move a tray window, sliding it if requested. */
+void MoveTrayWindow(TrayType *tp, int x, int y)
+{
+   tp->targetx = x;
+   tp->targety = y;
+   if(tp->slide) {
+      ScheduleCallback(TRAY_SLIDE_DELAY, SignalTraySlide, tp);
+   } else {
+      tp->windowx = x;
+      tp->windowy = y;
+      JXMoveWindow(display, tp->window, x, y);
+   }
+}
+
+/** Move a sliding tray one step closer to its target. */
+void SignalTraySlide(const TimeType *now, int x, int y, Window w, void *data)
+{
+   TrayType *tp = (TrayType*)data;
+   const int dx = tp->targetx - tp->windowx;
+   const int dy = tp->targety - tp->windowy;
+
+   /* Cover half the remaining distance each step. */
+   tp->windowx += (dx / 2 != 0) ? dx / 2 : dx;
+   tp->windowy += (dy / 2 != 0) ? dy / 2 : dy;
+   JXMoveWindow(display, tp->window, tp->windowx, tp->windowy);
+
+   if(tp->windowx != tp->targetx || tp->windowy != tp->targety) {
+      ScheduleCallback(TRAY_SLIDE_DELAY, SignalTraySlide, tp);
    }
 }
 
@@ -633,7 +682,7 @@ void HideTray(TrayType *tp)
    }
 
    /* Move and redraw. */
-   JXMoveWindow(display, tp->window, x, y);
+   MoveTrayWindow(tp, x, y);
    DrawSpecificTray(tp);
 }
 
@@ -651,6 +700,9 @@ char ProcessTrayEvent(const XEvent *event)
          case EnterNotify:
             HandleTrayEnterNotify(tp, &event->xcrossing);
             return 1;
+         case LeaveNotify:
+            HandleTrayLeaveNotify(tp, &event->xcrossing);
+            return 1;
          case ButtonPress:
             HandleTrayButtonPress(tp, &event->xbutton);
             return 1;
@@ -669,23 +721,25 @@ char ProcessTrayEvent(const XEvent *event)
    return 0;
 }
 
-/** Signal the tray (needed for autohide). */
+/** Hide a tray once the autohide delay expires. */
 void SignalTray(const TimeType *now, int x, int y, Window w, void *data)
 {
    TrayType *tp = (TrayType*)data;
    Assert(tp->autoHide != THIDE_OFF);
-   if(tp->hidden || menuShown) {
+   if(tp->hidden || tp->pointerInside) {
       return;
    }
 
-   if(x < tp->x || x >= tp->x + tp->width
-      || y < tp->y || y >= tp->y + tp->height) {
-      if(GetTimeDifference(now, &tp->showTime) >= tp->autoHideDelay) {
-         HideTray(tp);
-      }
-   } else {
-      tp->showTime = *now;
+   /* Wait for menus to close and for the mouse to leave the tray.
+    * Closing a menu with the mouse over the tray generates an
+    * EnterNotify, which cancels this. */
+   if(menuShown || (   x >= tp->x && x < tp->x + tp->width
+                    && y >= tp->y && y < tp->y + tp->height)) {
+      ScheduleCallback(Max(tp->autoHideDelay, 100), SignalTray, tp);
+      return;
    }
+
+   HideTray(tp);
 }
 
 /** Handle a tray expose event. */
@@ -697,9 +751,24 @@ void HandleTrayExpose(TrayType *tp, const XExposeEvent *event)
 /** Handle a tray enter notify (for autohide). */
 void HandleTrayEnterNotify(TrayType *tp, const XCrossingEvent *event)
 {
+   if(event->detail != NotifyInferior && event->mode == NotifyNormal) {
+      tp->pointerInside = 1;
+      CancelCallback(SignalTray, tp);
+   }
    ShowTray(tp);
 }
 
+/** Handle a tray leave notify (for autohide). */
+void HandleTrayLeaveNotify(TrayType *tp, const XCrossingEvent *event)
+{
+   /* Grabs (for example, moving a window from the pager) generate
+    * crossing events without the mouse moving. */
+   if(event->detail != NotifyInferior && event->mode == NotifyNormal) {
+      tp->pointerInside = 0;
+      ScheduleHideTray(tp);
+   }
+}
+
 /** Get the tray component under the given coordinates. */
 TrayComponentType *GetTrayComponent(TrayType *tp, int x, int y)
 {
@@ -829,6 +898,7 @@ void RaiseTrays(void)
       ShowTray(tp);
       JXRaiseWindow(display, tp->window);
    }
+   InvalidateStackOrder();
 }
 
 /** Lower tray windows. */
@@ -837,6 +907,7 @@ void LowerTrays(void)
    TrayType *tp;
    for(tp = trays; tp; tp = tp->next) {
       tp->autoHide &= ~THIDE_RAISED;
+      ScheduleHideTray(tp);
    }
    RequireRestack();
 }
@@ -855,6 +926,20 @@ void UpdateSpecificTray(const TrayType *tp, const TrayComponentType *cp)
    }
 }
 
+/** Update part of a specific component on a tray. */
+void UpdateSpecificTrayArea(const TrayType *tp, const TrayComponentType *cp,
+                            int x, int y, int width, int height)
+{
+   if(JUNLIKELY(shouldExit)) {
+      return;
+   }
+
+   if(cp->pixmap != None) {
+      JXCopyArea(display, cp->pixmap, tp->window, rootGC, x, y,
+                 width, height, cp->x + x, cp->y + y);
+   }
+}
+
 /** Layout tray components on a tray. */
 void LayoutTray(TrayType *tp, int *variableSize, int *variableRemainder)
 {
@@ -1005,6 +1090,9 @@ void ResizeTray(TrayType *tp)
 
    JXMoveResizeWindow(display, tp->window, tp->x, tp->y,
                       tp->width, tp->height);
+   CancelCallback(SignalTraySlide, tp);
+   tp->windowx = tp->targetx = tp->x;
+   tp->windowy = tp->targety = tp->y;
 
    RequireTaskUpdate();
    DrawSpecificTray(tp);
@@ -1043,18 +1131,12 @@ unsigned int GetTrayCount(void)
 /** Determine if a tray should autohide. */
 void SetAutoHideTray(TrayType *tp,
                      TrayAutoHideType autohide,
-                     unsigned timeout_ms)
+                     unsigned timeout_ms,
+                     char slide)
 {
-   if(JUNLIKELY(tp->autoHide != THIDE_OFF)) {
-      UnregisterCallback(SignalTray, tp);
-   }
-
    tp->autoHide = autohide;
    tp->autoHideDelay = timeout_ms;
-
-   if(autohide != THIDE_OFF) {
-      RegisterCallback(timeout_ms, SignalTray, tp);
-   }
+   tp->slide = slide;
 }
 
 /** Set the x-coordinate of a tray. */
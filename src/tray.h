@@ -142,10 +142,16 @@ typedef struct TrayType {
    TrayAlignmentType valign;  /**< Vertical alignment. */
    TrayAlignmentType halign;  /**< Horizontal alignment. */
 
-   TimeType showTime;
    TrayAutoHideType  autoHide;
    unsigned autoHideDelay;
    char hidden;     /**< 1 if hidden (due to autohide), 0 otherwise. */
+   char pointerInside;  /**< 1 if the mouse is over the tray. */
+   char slide;      /**< 1 to slide the tray when hiding and showing. */
+
+   int windowx;   /**< Current x-coordinate of the tray window. */
+   int windowy;   /**< Current y-coordinate of the tray window. */
+   int targetx;   /**< x-coordinate the tray window is sliding to. */
+   int targety;   /**< y-coordinate the tray window is sliding to. */
 
    Window window; /**< The tray window. */
 
@@ -213,6 +219,18 @@ void LowerTrays(void);
  */
 void UpdateSpecificTray(const TrayType *tp, const TrayComponentType *cp);
 
+/** Update part of a component on a tray.
+ * This copies only the specified area of the component pixmap.
+ * @param tp The tray containing the component.
+ * @param cp The component that needs updating.
+ * @param x The x-coordinate of the area relative to the component.
+ * @param y The y-coordinate of the area relative to the component.
+ * @param width The width of the area.
+ * @param height The height of the area.
+ */
+void UpdateSpecificTrayArea(const TrayType *tp, const TrayComponentType *cp,
+                            int x, int y, int width, int height);
+
 /** Resize a tray.
  * @param tp The tray to resize containing the new requested size information.
  */
@@ -241,10 +259,12 @@ char ProcessTrayEvent(const XEvent *event);
  * @param tp The tray.
  * @param autohide The auto-hide setting.
  * @param delay_ms The auto-hide timeout in milliseconds.
+ * @param slide 1 to slide the tray in and out, 0 to move it at once.
  */
 void SetAutoHideTray(TrayType *tp,
                      TrayAutoHideType autohide,
-                     unsigned delay_ms);
+                     unsigned delay_ms,
+                     char slide);
 
 /** Set the tray x-coordinate.
  * @param tp The tray.
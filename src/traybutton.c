@@ -37,10 +37,6 @@ typedef struct TrayButtonType {
    char *iconName;
    IconNode *icon;
 
-   int mousex;
-   int mousey;
-   TimeType mouseTime;
-
    struct ActionNode *actions;
    struct TrayButtonType *next;
 
@@ -60,13 +56,15 @@ static void ProcessButtonRelease(TrayComponentType *cp,
                                  int x, int y, int button);
 static void ProcessMotionEvent(TrayComponentType *cp,
                                int x, int y, int mask);
-static void SignalTrayButton(const TimeType *now,
-                             int x, int y, Window w, void *data);
+static const char *GetButtonPopup(void *object, int x, int y);
 
 /** Startup tray buttons. */
 void StartupTrayButtons(void)
 {
    TrayButtonType *bp;
+   for(bp = buttons; bp; bp = bp->next) {
+      PrefetchNamedIcon(bp->iconName);
+   }
    for(bp = buttons; bp; bp = bp->next) {
       if(bp->label) {
          bp->cp->requestedWidth
@@ -98,7 +96,6 @@ void DestroyTrayButtons(void)
    TrayButtonType *bp;
    while(buttons) {
       bp = buttons->next;
-      UnregisterCallback(SignalTrayButton, buttons);
       if(buttons->label) {
          Release(buttons->label);
       }
@@ -147,9 +144,6 @@ TrayComponentType *CreateTrayButton(const char *iconName,
    cp->requestedWidth = width;
    cp->requestedHeight = height;
 
-   bp->mousex = -settings.doubleClickDelta;
-   bp->mousey = -settings.doubleClickDelta;
-
    cp->Create = Create;
    cp->Destroy = Destroy;
    cp->SetSize = SetSize;
@@ -162,8 +156,6 @@ TrayComponentType *CreateTrayButton(const char *iconName,
       cp->ProcessMotionEvent = ProcessMotionEvent;
    }
 
-   RegisterCallback(settings.popupDelay / 2, SignalTrayButton, bp);
-
    return cp;
 
 }
@@ -313,30 +305,18 @@ void ProcessButtonRelease(TrayComponentType *cp, int x, int y, int button)
 void ProcessMotionEvent(TrayComponentType *cp, int x, int y, int mask)
 {
    TrayButtonType *bp = (TrayButtonType*)cp->object;
-   bp->mousex = cp->screenx + x;
-   bp->mousey = cp->screeny + y;
-   GetCurrentTime(&bp->mouseTime);
+   HoverPopup(GetButtonPopup, bp, POPUP_BUTTON, cp->tray->window,
+              cp->screenx + x, cp->screeny + y);
 }
 
-/** Signal (needed for popups). */
-void SignalTrayButton(const TimeType *now, int x, int y, Window w, void *data)
+/** Get the popup text for a tray button. */
+const char *GetButtonPopup(void *object, int x, int y)
 {
-   TrayButtonType *bp = (TrayButtonType*)data;
-   const char *popup;
-
+   const TrayButtonType *bp = (TrayButtonType*)object;
    if(bp->popup) {
-      popup = bp->popup;
-   } else if(bp->label) {
-      popup = bp->label;
+      return bp->popup;
    } else {
-      return;
-   }
-   if(bp->cp->tray->window == w &&
-      abs(bp->mousex - x) < settings.doubleClickDelta &&
-      abs(bp->mousey - y) < settings.doubleClickDelta) {
-      if(GetTimeDifference(now, &bp->mouseTime) >= settings.popupDelay) {
-         ShowPopup(x, y, popup, POPUP_BUTTON);
-      }
+      return bp->label;
    }
 }
 